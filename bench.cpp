@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "math/color.hpp"
+#include "math/raygen.hpp"
+#include "math/vector.hpp"
+#include "renderer/pool.hpp"
+#include "renderer/resolve.hpp"
+#include "renderer/sampler.hpp"
+#include "renderer/telemetry.hpp"
+#include "renderer/tracer.hpp"
+#include "scene/scene.hpp"
+
+// Build a test scene of a triangulated height field with a few spheres
+// Offset moves the whole scene away from the origin
+Scene benchScene(const Vector& offset) {
+  Scene scene{256, 256, 4};
+
+  scene.setBackground(135, 206, 235);
+  scene.setCamera(offset + Vector(0.0, -2.5, 1.5), Vector(0, 1, -0.4), 60.0);
+  scene.setAmbientLight(0.2);
+  scene.addLight(offset + Vector(-1.0, -1.0, 3.0), Color(255, 255, 255));
+
+  const Material ground{.color = Color(200, 180, 120), .reflectivity = 0.1};
+  const int n = 64;
+  auto height = [](double x, double y) {
+    return 0.15 * std::sin(4.0 * x) * std::cos(3.0 * y);
+  };
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      const double x0 = -2.0 + 4.0 * i / n, x1 = -2.0 + 4.0 * (i + 1) / n;
+      const double y0 = -1.0 + 4.0 * j / n, y1 = -1.0 + 4.0 * (j + 1) / n;
+      const Vector a = offset + Vector(x0, y0, height(x0, y0));
+      const Vector b = offset + Vector(x1, y0, height(x1, y0));
+      const Vector c = offset + Vector(x1, y1, height(x1, y1));
+      const Vector d = offset + Vector(x0, y1, height(x0, y1));
+      scene.addTriangle(a, b, c, ground);
+      scene.addTriangle(a, c, d, ground);
+    }
+  }
+
+  scene.addSphere(offset + Vector(-0.5, 0.5, 0.5), 0.4,
+                  (Material){.color = Color(255, 0, 0), .reflectivity = 0.5});
+  scene.addSphere(offset + Vector(0.6, 0.9, 0.4), 0.3,
+                  (Material){.color = Color(0, 0, 255), .reflectivity = 0.7});
+  return scene;
+}
+
+// Render one pass and return averaged colors
+// Sample positions depend only on the pixel, so runs are comparable
+std::vector<Color> renderPass(Scene& scene, double& seconds) {
+  Pixels pixels(scene.getWidth(), scene.getHeight());
+  Tracer tracer{scene};
+
+  const auto start = std::chrono::steady_clock::now();
+  tracer.renderPass(pixels);
+  const auto end = std::chrono::steady_clock::now();
+  seconds = std::chrono::duration<double>(end - start).count();
+
+  std::vector<Color> colors(pixels.pxColors.size());
+  for (size_t i = 0; i < colors.size(); ++i) {
+    colors[i] = pixels.pxColors[i] / static_cast<double>(pixels.pxSamples[i]);
+  }
+  return colors;
+}
+
+// Largest 8-bit channel difference per pixel: (mean, max, differing pixels)
+std::tuple<double, int, int> imageError(const std::vector<Color>& image,
+                                        const std::vector<Color>& reference) {
+  double sumErr = 0.0;
+  int maxErr = 0, diffPixels = 0;
+  for (size_t i = 0; i < image.size(); ++i) {
+    const auto a = image[i].getBytes();
+    const auto b = reference[i].getBytes();
+    int pixelErr = 0;
+    for (int c = 0; c < 3; ++c) {
+      pixelErr = std::max(pixelErr, std::abs(a[c] - b[c]));
+    }
+    sumErr += pixelErr;
+    maxErr = std::max(maxErr, pixelErr);
+    if (pixelErr > 0) diffPixels++;
+  }
+  return {sumErr / image.size(), maxErr, diffPixels};
+}
+
+// Compare speed and image error of each precision mode against the double
+// path with the scene at the origin, then with the scene moved far away
+void benchPrecision() {
+  std::cout << "Benchmarking precision modes..." << std::endl;
+
+  const int runs = 3;
+  const std::pair<Precision, const char*> modes[] = {
+      {Precision::Double, "double"},
+      {Precision::Float, "float"},
+      {Precision::FloatRefined, "float+refine"}};
+
+  std::vector<Color> reference;
+  for (const Vector& offset : {Vector(0.0), Vector(1e5, 1e5, 0.0)}) {
+    std::cout << "  scene offset " << offset << std::endl;
+    Scene scene = benchScene(offset);
+    const double numPixels = scene.getWidth() * scene.getHeight();
+    double doubleTime = 0.0;
+
+    for (const auto& [precision, name] : modes) {
+      scene.setPrecision(precision);
+
+      // Best of several runs
+      double best = std::numeric_limits<double>::max();
+      std::vector<Color> image;
+      for (int r = 0; r < runs; ++r) {
+        double seconds;
+        image = renderPass(scene, seconds);
+        best = std::min(best, seconds);
+      }
+      if (precision == Precision::Double) doubleTime = best;
+      if (reference.empty()) reference = image;
+
+      const auto [meanErr, maxErr, diffPixels] = imageError(image, reference);
+      std::cout << "    " << std::setw(13) << std::left << name << std::right
+                << std::fixed << std::setprecision(1) << std::setw(8)
+                << numPixels / best / 1e3 << " kpx/s  speedup "
+                << std::setprecision(2) << doubleTime / best << "x  mean err "
+                << std::setprecision(4) << meanErr << "  max err " << maxErr
+                << "  differing px " << diffPixels << std::endl;
+    }
+  }
+}
+
+// Throughput of the thread pool with tiny tasks as the worker count grows
+// External: all tasks enqueued from this thread (injection queue)
+// Nested: each task enqueues its children from inside the pool (deques)
+void benchPoolContention() {
+  std::cout << "Benchmarking thread pool contention..." << std::endl;
+
+  const int numTasks = 200000;
+  const int maxWorkers =
+      std::max(4, 2 * static_cast<int>(std::thread::hardware_concurrency()));
+  std::atomic<long> sink{0};
+
+  // A little work per task so the pool overhead dominates but is not all
+  auto work = [&sink](int i) {
+    long x = i;
+    for (int k = 0; k < 50; ++k) x = x * 31 + k;
+    sink.fetch_add(x & 1, std::memory_order_relaxed);
+  };
+
+  for (int workers = 1; workers <= maxWorkers; workers *= 2) {
+    ThreadPool pool(workers);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numTasks; ++i) {
+      pool.enqueue([&work, i] { work(i); });
+    }
+    pool.wait();
+    const double external = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+
+    // Binary tree of tasks spawned from inside the pool
+    std::function<void(int, int)> spawn = [&](int begin, int end) {
+      if (end - begin == 1) {
+        work(begin);
+        return;
+      }
+      const int mid = (begin + end) / 2;
+      pool.enqueue([&spawn, begin, mid] { spawn(begin, mid); });
+      pool.enqueue([&spawn, mid, end] { spawn(mid, end); });
+    };
+    start = std::chrono::steady_clock::now();
+    pool.enqueue([&spawn] { spawn(0, numTasks); });
+    pool.wait();
+    const double nested = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+    std::cout << "  " << std::setw(3) << workers << " workers  external "
+              << std::fixed << std::setprecision(2) << std::setw(6)
+              << numTasks / external / 1e6 << " Mtasks/s  nested "
+              << std::setw(6) << 2.0 * numTasks / nested / 1e6
+              << " Mtasks/s" << std::endl;
+  }
+}
+
+// Render throughput with workers free to migrate versus pinned to CPUs with
+// the pixel pages faulted in from the pool
+void benchPinning() {
+  std::cout << "Benchmarking worker pinning..." << std::endl;
+  if (!ThreadPool::pinningSupported()) {
+    std::cout << "  pinning not supported on this platform" << std::endl;
+  }
+
+  const int passes = 8;
+  const int runs = 3;
+  Scene scene = benchScene(Vector(0.0));
+  const double numPixels = scene.getWidth() * scene.getHeight();
+  double unpinnedTime = 0.0;
+
+  for (const bool pinned : {false, true}) {
+    ThreadPool pool(ThreadPool::defaultSize(), pinned);
+    Tracer tracer{scene, pool};
+
+    // Best of several runs
+    double best = std::numeric_limits<double>::max();
+    for (int r = 0; r < runs; ++r) {
+      Pixels pixels(scene.getWidth(), scene.getHeight());
+      if (pinned) tracer.prefault(pixels);
+
+      const auto start = std::chrono::steady_clock::now();
+      for (int p = 0; p < passes; ++p) tracer.renderPass(pixels);
+      const auto end = std::chrono::steady_clock::now();
+      best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    if (!pinned) unpinnedTime = best;
+
+    std::cout << "  " << std::setw(9) << std::left
+              << (pinned ? "pinned" : "unpinned") << std::right << std::fixed
+              << std::setprecision(1) << std::setw(8)
+              << passes * numPixels / best / 1e3 << " kpx/s  speedup "
+              << std::setprecision(2) << unpinnedTime / best << "x"
+              << std::endl;
+  }
+}
+
+// Time from enqueue until the task starts, with idle workers parking at once
+// versus spinning first, for tasks arriving shortly after the last one (as in
+// a frame's bursts) and after a longer idle period
+void benchWakeLatency() {
+  std::cout << "Benchmarking wakeup latency..." << std::endl;
+
+  using Clock = std::chrono::steady_clock;
+  const int samples = 2000;
+  const std::pair<int, const char*> policies[] = {{0, "park"},
+                                                  {50, "spin 50us"}};
+
+  for (const auto& [spinMicros, name] : policies) {
+    ThreadPool pool(ThreadPool::defaultSize());
+    pool.setSpinTime(std::chrono::microseconds(spinMicros));
+
+    for (const int gapMicros : {10, 1000}) {
+      std::vector<double> latencies(samples);
+      for (int i = 0; i < samples; ++i) {
+        // Busy-wait the gap: sleeping that briefly is far too coarse
+        const auto until = Clock::now() + std::chrono::microseconds(gapMicros);
+        while (Clock::now() < until) {
+        }
+
+        const auto start = Clock::now();
+        pool.enqueue([&latencies, i, start] {
+          latencies[i] =
+              std::chrono::duration<double, std::micro>(Clock::now() - start)
+                  .count();
+        });
+        pool.wait();
+      }
+
+      std::sort(latencies.begin(), latencies.end());
+      const auto percentile = [&](double p) {
+        return latencies[static_cast<int>(p * (samples - 1))];
+      };
+      std::cout << "  " << std::setw(10) << std::left << name << std::right
+                << " gap " << std::setw(4) << gapMicros << "us  p50 "
+                << std::fixed << std::setprecision(1) << std::setw(6)
+                << percentile(0.5) << "us  p90 " << std::setw(6)
+                << percentile(0.9) << "us  p99 " << std::setw(7)
+                << percentile(0.99) << "us  max " << std::setw(8)
+                << latencies.back() << "us" << std::endl;
+    }
+  }
+}
+
+// Error against a converged reference after a few samples per pixel, for
+// each anti-aliasing sampler
+void benchSamplers() {
+  std::cout << "Benchmarking sampler convergence (RMS error)..." << std::endl;
+
+  Scene scene = benchScene(Vector(0.0));
+  auto average = [](const Pixels& pixels) {
+    std::vector<Color> colors(pixels.pxColors.size());
+    for (size_t i = 0; i < colors.size(); ++i) {
+      colors[i] = pixels.pxColors[i] / static_cast<double>(pixels.pxSamples[i]);
+    }
+    return colors;
+  };
+
+  Tracer reference{scene};
+  Pixels converged(scene.getWidth(), scene.getHeight());
+  for (int p = 0; p < 64; ++p) reference.renderPass(converged);
+  const std::vector<Color> truth = average(converged);
+
+  const std::pair<SamplerType, const char*> samplers[] = {
+      {SamplerType::Stratified, "stratified"},
+      {SamplerType::Sobol, "sobol"},
+      {SamplerType::R2, "r2"},
+      {SamplerType::BlueNoise, "blue noise"}};
+  for (const auto& [type, name] : samplers) {
+    Tracer tracer{scene};
+    tracer.setSampler(makeSampler(type, 1));  // Not the reference's seed
+    Pixels pixels(scene.getWidth(), scene.getHeight());
+    std::cout << "  " << std::setw(10) << std::left << name << std::right;
+    for (int p = 1; p <= 16; ++p) {
+      tracer.renderPass(pixels);
+      if ((p & (p - 1)) != 0) continue;  // Report at powers of two
+      const std::vector<Color> image = average(pixels);
+      double sum = 0.0;
+      for (size_t i = 0; i < image.size(); ++i) {
+        const double d = image[i].luminance() - truth[i].luminance();
+        sum += d * d;
+      }
+      std::cout << "  " << std::setw(2) << p << " spp " << std::fixed
+                << std::setprecision(4) << std::sqrt(sum / image.size());
+    }
+    std::cout << std::endl;
+  }
+}
+
+// Primary rays per second: Camera::ray per pixel, RayGenerator per pixel
+// and RayGenerator filling 32x32 tiles
+void benchRayGeneration() {
+  std::cout << "Benchmarking ray generation..." << std::endl;
+
+  const Scene scene = benchScene(Vector(0.0));
+  const Camera camera = scene.getCamera();
+  const int w = scene.getWidth(), h = scene.getHeight();
+  const int frames = 20;
+  using Clock = std::chrono::steady_clock;
+  double sink = 0.0;  // Keeps the rays from being optimized away
+
+  auto report = [&](const char* name, Clock::time_point start) {
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  " << std::setw(16) << std::left << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(8)
+              << frames * w * h / seconds / 1e6 << " Mrays/s" << std::endl;
+  };
+
+  auto start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) sink += camera.ray(x, y, w, h).dir.x();
+    }
+  }
+  report("Camera::ray", start);
+
+  start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    const RayGenerator rays(camera, w, h);
+    for (int y = 0; y < h; ++y) {
+      for (int x = 0; x < w; ++x) sink += rays.ray(x, y).dir.x();
+    }
+  }
+  report("RayGenerator", start);
+
+  start = Clock::now();
+  RayBatch batch;
+  batch.resize(32 * 32);
+  for (int f = 0; f < frames; ++f) {
+    const RayGenerator rays(camera, w, h);
+    for (int y = 0; y < h; y += 32) {
+      for (int x = 0; x < w; x += 32) {
+        rays.tile(x, y, x + 32, y + 32, batch);
+        sink += batch.dirX[0];
+      }
+    }
+  }
+  report("RayGenerator 32^2", start);
+  if (sink == 42.0) std::cout << "";
+}
+
+// 8-bit conversion of a 512x512 frame: per-pixel Color math and getBytes
+// against Resolver rows, linear and through the sRGB table
+void benchResolve() {
+  std::cout << "Benchmarking 8-bit resolve..." << std::endl;
+
+  const int w = 512, h = 512, frames = 20;
+  std::vector<Color> colors(w * h);
+  std::vector<int> samples(w * h);
+  for (int i = 0; i < w * h; ++i) {
+    samples[i] = 1 + i % 16;
+    colors[i] = Color((i % 97) / 97.0, (i % 89) / 60.0, (i % 83) / 83.0) *
+                static_cast<double>(samples[i]);
+  }
+  std::vector<uint8_t> image8(w * h * 4);
+  using Clock = std::chrono::steady_clock;
+
+  auto report = [&](const char* name, Clock::time_point start) {
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  " << std::setw(12) << std::left << name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(8)
+              << frames * w * h / seconds / 1e6 << " Mpx/s" << std::endl;
+  };
+
+  auto start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    for (int i = 0; i < w * h; ++i) {
+      const auto bytes =
+          (colors[i] / static_cast<double>(samples[i])).clamp().getBytes();
+      image8[i * 3] = bytes[0];
+      image8[i * 3 + 1] = bytes[1];
+      image8[i * 3 + 2] = bytes[2];
+    }
+  }
+  report("getBytes", start);
+
+  const Resolver linear;
+  start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    for (int y = 0; y < h; ++y) {
+      linear.resolveRow(&colors[y * w], &samples[y * w], w,
+                        &image8[y * w * 3], 3);
+    }
+  }
+  report("linear", start);
+
+  const Resolver srgb(ToneMapping{.curve = ToneCurve::SRGB});
+  start = Clock::now();
+  for (int f = 0; f < frames; ++f) {
+    for (int y = 0; y < h; ++y) {
+      srgb.resolveRow(&colors[y * w], &samples[y * w], w,
+                      &image8[y * w * 4], 4);
+    }
+  }
+  report("sRGB RGBA", start);
+}
+
+// Where a few render passes spend their time, per worker
+void benchSchedulerStats() {
+  std::cout << "Scheduler stats for 4 passes..." << std::endl;
+
+  Scene scene = benchScene(Vector(0.0));
+  ThreadPool pool(ThreadPool::defaultSize());
+  Tracer tracer{scene, pool};
+  Pixels pixels(scene.getWidth(), scene.getHeight());
+  for (int p = 0; p < 4; ++p) tracer.renderPass(pixels);
+  printStats(std::cout, pool.stats());
+}
+
+int main() {
+  benchPrecision();
+  benchPoolContention();
+  benchPinning();
+  benchWakeLatency();
+  benchSamplers();
+  benchRayGeneration();
+  benchResolve();
+  benchSchedulerStats();
+
+  return 0;
+}
@@ -3,51 +3,38 @@
 #include <fstream>
 
 #include "io/tinyfiledialogs.hpp"
-#include "renderer/tracer.hpp"
 
 Image::Image(Scene& sc, int quality)
     : scene(sc),
-      pixels(std::vector<uint8_t>(sc.getWidth() * sc.getHeight() * 3, 0)) {
-  const Pixels tempPixels(sc.getWidth(), sc.getHeight());
-  Tracer tracer{sc};
-
-  for (int q = 0; q < quality; ++q) {
-    tracer.refinePixels(const_cast<Pixels&>(tempPixels));
-  }
-  tracer.wait();
+      pixels(renderAsync(sc, quality, Priority::Interactive).get()) {}
+
+// Ask the user where to save (empty if cancelled)
+static std::string askFilename() {
+  // Get filename from user from tinyfiledialogs
+  const char* saveFile = tinyfd_saveFileDialog("Save file",     // title
+                                               "./output.ppm",  // default name
+                                               0, NULL,         // no filters
+                                               "Text Files"     // description
+  );
+  return saveFile ? saveFile : "";
+}
 
-  // Convert to 8-bit per channel
-  for (int y = 0; y < sc.getHeight(); ++y) {
-    for (int x = 0; x < sc.getWidth(); ++x) {
-      const int i = y * sc.getWidth() + x;
-      const Color col =
-          tempPixels.pxColors[i] / static_cast<double>(tempPixels.pxSamples[i]);
-      const int rIndex = i * 3;
-      const auto bytes = col.clamp().getBytes();
-      const_cast<uint8_t&>(pixels[rIndex]) = bytes[0];
-      const_cast<uint8_t&>(pixels[rIndex + 1]) = bytes[1];
-      const_cast<uint8_t&>(pixels[rIndex + 2]) = bytes[2];
-    }
-  }
+// Write the file on a background worker; the image must outlive the job
+// Without a filename the dialog is shown first, on the calling thread: it
+// must not block a worker, and GUI calls belong on the main thread
+Job<bool> Image::saveAsync(std::string filename, ThreadPool& pool) const {
+  if (filename.empty()) filename = askFilename();
+  if (filename.empty()) co_return false;
+  co_await pool.schedule(Priority::Background);
+  co_return save(filename);
 }
 
 // Save the image to a PPM file (return true on success)
 bool Image::save(std::string filename) const {
-  char* saveFile;
-
-  if (filename.empty()) {
-    // Get filename from user from tinyfiledialogs
-    saveFile = tinyfd_saveFileDialog("Save file",     // title
-                                     "./output.ppm",  // default name
-                                     0, NULL,         // no filters
-                                     "Text Files"     // description
-    );
-    if (!saveFile) return false;
-  } else {
-    saveFile = const_cast<char*>(filename.c_str());
-  }
+  if (filename.empty()) filename = askFilename();
+  if (filename.empty()) return false;
 
-  std::ofstream output(saveFile, std::ios::binary);
+  std::ofstream output(filename, std::ios::binary);
   if (!output.is_open()) {
     return false;
   }
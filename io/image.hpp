@@ -4,10 +4,12 @@
 #include <vector>
 
 #include "math/color.hpp"
+#include "renderer/job.hpp"
 #include "renderer/renderer.hpp"
 
 // Handles image creation and saving to files
 // Quality parameter controls number of samples per pixel
+// For several renders or saves at once, use renderAsync and saveAsync
 class Image {
  private:
   const Scene& scene;
@@ -17,7 +19,11 @@ class Image {
   Image(const Renderer& renderer)
       : scene(renderer.scene), pixels(renderer.image8) {}
   Image(Scene& sc, int quality = 17);
+  Image(const Scene& sc, std::vector<uint8_t> image8)
+      : scene(sc), pixels(std::move(image8)) {}
   bool save(std::string filename = "") const;
+  Job<bool> saveAsync(std::string filename,
+                      ThreadPool& pool = ThreadPool::shared()) const;
 
   ~Image() = default;
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 // Generate a ray from the camera through pixel (i, j)
 // i, j can be fractional for anti-aliasing
+// Recomputes the camera basis: use RayGenerator for many rays
 Ray Camera::ray(const double i, const double j, const int width,
                 const int height) const {
   const double w = static_cast<double>(width);
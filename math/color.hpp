@@ -40,6 +40,10 @@ class Color {
   bool operator!=(const Color& other) const { return v != other.v; }
 
   double mag() const { return v.mag(); }
+  // Relative luminance (Rec. 709 weights)
+  double luminance() const {
+    return 0.2126 * v.x() + 0.7152 * v.y() + 0.0722 * v.z();
+  }
 
   friend std::ostream& operator<<(std::ostream& os, const Color& c);
   friend inline Color operator*(double scalar, const Color& color) {
@@ -1,5 +1,41 @@
 #include "ray.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
 #include "vector.hpp"
 
 Vector Ray::at(double t) const { return orig + dir * t; }
+
+// Round ray to float and precompute shear constants (Woop et al. 2013)
+FloatRay::FloatRay(const Ray& ray) {
+  for (int i = 0; i < 3; ++i) {
+    orig[i] = static_cast<float>(ray.orig[i]);
+    dir[i] = static_cast<float>(ray.dir[i]);
+    invDir[i] = 1.0f / dir[i];
+    origErr[i] = std::nextafter(
+        static_cast<float>(std::abs(ray.orig[i] - orig[i])), INFINITY);
+  }
+
+  kz = 0;
+  if (std::abs(dir[1]) > std::abs(dir[kz])) kz = 1;
+  if (std::abs(dir[2]) > std::abs(dir[kz])) kz = 2;
+  kx = (kz + 1) % 3;
+  ky = (kx + 1) % 3;
+  // Swap to preserve winding when looking down -z
+  if (dir[kz] < 0.0f) std::swap(kx, ky);
+
+  sx = dir[kx] / dir[kz];
+  sy = dir[ky] / dir[kz];
+  sz = 1.0f / dir[kz];
+
+  // Secondary rays start on a surface; after rounding the origin to float
+  // they can re-hit that surface at a tiny distance
+  const float maxOrig = std::max(
+      {std::abs(orig[0]), std::abs(orig[1]), std::abs(orig[2]), 1.0f});
+  const float dirLen =
+      std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+  tMin = SELF_HIT_ULPS * FLT_EPSILON * maxOrig / dirLen;
+}
@@ -15,4 +15,21 @@ class Ray {
   Vector at(double t) const;
 
   ~Ray() = default;
+};
+
+// Single-precision copy of a ray for fast BVH traversal
+// Also holds the per-ray constants of the watertight triangle test
+struct FloatRay {
+  float orig[3];
+  float dir[3];
+  float invDir[3];
+  float origErr[3];  // Rounding error of orig, used to widen box tests
+  int kx, ky, kz;    // Axis permutation (kz is the largest |dir| component)
+  float sx, sy, sz;  // Shear constants mapping dir onto the +z axis
+  float tMin;        // Hits closer than this may be float self-intersections
+
+  // Minimum hit distance in float ulps of the largest origin coordinate
+  static constexpr float SELF_HIT_ULPS = 16.0f;
+
+  FloatRay(const Ray& ray);
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "raygen.hpp"
+
+RayGenerator::RayGenerator(const Camera& camera, int width, int height)
+    : origin(camera.position), forward(camera.direction) {
+  const double w = static_cast<double>(width);
+  const double h = static_cast<double>(height);
+
+  // Screen half-sizes on an image plane at distance 1
+  const double halfHeight = std::tan(camera.fov * 0.5 * M_PI / 180.0);
+  const double halfWidth = (w / h) * halfHeight;
+
+  // Camera basis (Y up)
+  const Vector right = camera.direction.cross(Vector(0, 0, 1)).norm();
+  const Vector up = right.cross(camera.direction).norm();
+
+  corner = forward - right * halfWidth + up * halfHeight;
+  stepX = right * (2.0 * halfWidth / w);
+  stepY = up * (-2.0 * halfHeight / h);
+}
+
+// Fill the directions of pixels [x0, x1) x [y0, y1) from batch's offsets
+// Plain arithmetic over arrays, so the compiler can vectorize it
+void RayGenerator::tile(int x0, int y0, int x1, int y1,
+                        RayBatch& batch) const {
+  batch.origin = origin;
+  const int w = x1 - x0;
+  const double cx = corner.x(), cy = corner.y(), cz = corner.z();
+  const double sxx = stepX.x(), sxy = stepX.y(), sxz = stepX.z();
+  const double syx = stepY.x(), syy = stepY.y(), syz = stepY.z();
+  const double* offX = batch.offsetX.data();
+  const double* offY = batch.offsetY.data();
+  double* dirX = batch.dirX.data();
+  double* dirY = batch.dirY.data();
+  double* dirZ = batch.dirZ.data();
+
+  for (int y = y0; y < y1; ++y) {
+    const int row = (y - y0) * w;
+    for (int k = row; k < row + w; ++k) {
+      const double i = x0 + (k - row) + offX[k];
+      const double j = y + offY[k];
+      const double x = std::fma(syx, j, std::fma(sxx, i, cx));
+      const double yy = std::fma(syy, j, std::fma(sxy, i, cy));
+      const double z = std::fma(syz, j, std::fma(sxz, i, cz));
+      const double invLen = 1.0 / std::sqrt(x * x + yy * yy + z * z);
+      dirX[k] = x * invLen;
+      dirY[k] = yy * invLen;
+      dirZ[k] = z * invLen;
+    }
+  }
+}
+
+// Image position whose ray points along dir, if dir is in front of the camera
+// Inverse of ray(): the steps are orthogonal to each other and to forward
+std::optional<ImagePoint> RayGenerator::projectDir(const Vector& dir) const {
+  const double ahead = dir * forward;
+  if (ahead <= 0.0) return std::nullopt;
+  const Vector offset = dir / ahead - corner;
+  return ImagePoint{(offset * stepX) / (stepX * stepX),
+                    (offset * stepY) / (stepY * stepY)};
+}
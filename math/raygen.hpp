@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cmath>
+#include <optional>
+#include <vector>
+
+#include "camera.hpp"
+#include "ray.hpp"
+#include "vector.hpp"
+
+// Rays of a block of pixels, stored as structure of arrays (row-major)
+// The caller sets the sample offsets, RayGenerator::tile fills the rest
+struct RayBatch {
+  Vector origin;                         // Shared by all rays
+  std::vector<double> offsetX, offsetY;  // Sample position within the pixel
+  std::vector<double> dirX, dirY, dirZ;  // Normalized ray directions
+
+  void resize(size_t n) {
+    offsetX.resize(n);
+    offsetY.resize(n);
+    dirX.resize(n);
+    dirY.resize(n);
+    dirZ.resize(n);
+  }
+  size_t size() const { return dirX.size(); }
+  Ray ray(size_t k) const {
+    return Ray(origin, Vector(dirX[k], dirY[k], dirZ[k]));
+  }
+};
+
+// Continuous image position, in pixels from the top-left corner
+struct ImagePoint {
+  double i, j;
+};
+
+// Primary ray generation for one camera and image size, built once per frame
+// The image plane is precomputed as a corner and per-pixel steps, so a ray is
+// three FMAs per axis and a normalization instead of Camera::ray's trig,
+// cross products and two normalizations
+class RayGenerator {
+ private:
+  Vector origin;
+  Vector forward;  // View direction (unit)
+  Vector corner;   // Direction through the top-left corner of the image
+  Vector stepX;    // Change in direction per pixel to the right
+  Vector stepY;    // Change in direction per pixel down
+
+ public:
+  RayGenerator(const Camera& camera, int width, int height);
+
+  // Ray through image position (i, j), in pixels from the top-left corner
+  Ray ray(double i, double j) const {
+    const double x = std::fma(stepY.x(), j, std::fma(stepX.x(), i, corner.x()));
+    const double y = std::fma(stepY.y(), j, std::fma(stepX.y(), i, corner.y()));
+    const double z = std::fma(stepY.z(), j, std::fma(stepX.z(), i, corner.z()));
+    const double invLen = 1.0 / std::sqrt(x * x + y * y + z * z);
+    return Ray(origin, Vector(x * invLen, y * invLen, z * invLen));
+  }
+
+  void tile(int x0, int y0, int x1, int y1, RayBatch& batch) const;
+  std::optional<ImagePoint> projectDir(const Vector& dir) const;
+
+  const Vector& getOrigin() const { return origin; }
+
+  // Same view on an image factor times smaller in each axis
+  // Pixel (i, j) covers full-size pixels [i * factor, (i + 1) * factor)
+  RayGenerator downscaled(int factor) const {
+    RayGenerator scaled = *this;
+    scaled.stepX = stepX * static_cast<double>(factor);
+    scaled.stepY = stepY * static_cast<double>(factor);
+    return scaled;
+  }
+};
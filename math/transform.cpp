@@ -0,0 +1,120 @@
+#include "transform.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+#include "vector.hpp"
+
+// Identity transform
+Transform::Transform()
+    : m{{{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}}} {}
+
+// Translate by offset
+Transform Transform::translate(const Vector& offset) {
+  return Transform({{{1.0, 0.0, 0.0, offset.x()},
+                     {0.0, 1.0, 0.0, offset.y()},
+                     {0.0, 0.0, 1.0, offset.z()}}});
+}
+
+// Scale along each axis
+Transform Transform::scale(const Vector& factors) {
+  return Transform({{{factors.x(), 0.0, 0.0, 0.0},
+                     {0.0, factors.y(), 0.0, 0.0},
+                     {0.0, 0.0, factors.z(), 0.0}}});
+}
+
+// Rotate around axis (through the origin) using Rodrigues' formula
+Transform Transform::rotate(const Vector& axis, double degrees) {
+  const Vector a = axis.norm();
+  const double rad = degrees * M_PI / 180.0;
+  const double c = std::cos(rad);
+  const double s = std::sin(rad);
+  const double t = 1.0 - c;
+  const double x = a.x(), y = a.y(), z = a.z();
+
+  return Transform({{{t * x * x + c, t * x * y - s * z, t * x * z + s * y, 0.0},
+                     {t * x * y + s * z, t * y * y + c, t * y * z - s * x, 0.0},
+                     {t * x * z - s * y, t * y * z + s * x, t * z * z + c,
+                      0.0}}});
+}
+
+// Transform a point (applies translation)
+Vector Transform::applyPoint(const Vector& p) const {
+  return Vector(m[0][0] * p.x() + m[0][1] * p.y() + m[0][2] * p.z() + m[0][3],
+                m[1][0] * p.x() + m[1][1] * p.y() + m[1][2] * p.z() + m[1][3],
+                m[2][0] * p.x() + m[2][1] * p.y() + m[2][2] * p.z() + m[2][3]);
+}
+
+// Transform a direction (ignores translation)
+Vector Transform::applyVector(const Vector& v) const {
+  return Vector(m[0][0] * v.x() + m[0][1] * v.y() + m[0][2] * v.z(),
+                m[1][0] * v.x() + m[1][1] * v.y() + m[1][2] * v.z(),
+                m[2][0] * v.x() + m[2][1] * v.y() + m[2][2] * v.z());
+}
+
+// Multiply by the transpose of the linear part
+// Calling this on an inverse transform maps normals back to the original space
+Vector Transform::applyTransposed(const Vector& v) const {
+  return Vector(m[0][0] * v.x() + m[1][0] * v.y() + m[2][0] * v.z(),
+                m[0][1] * v.x() + m[1][1] * v.y() + m[2][1] * v.z(),
+                m[0][2] * v.x() + m[1][2] * v.y() + m[2][2] * v.z());
+}
+
+// Determinant of the linear part
+double Transform::determinant() const {
+  return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+         m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+         m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// Inverse transform (throws if the linear part is singular)
+Transform Transform::inverse() const {
+  const double det = determinant();
+  if (std::abs(det) < Vector::EPS) {
+    throw std::invalid_argument("Transform is not invertible");
+  }
+  const double invDet = 1.0 / det;
+
+  // Inverse of linear part from the adjugate
+  std::array<std::array<double, 4>, 3> inv;
+  inv[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * invDet;
+  inv[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * invDet;
+  inv[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * invDet;
+  inv[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * invDet;
+  inv[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * invDet;
+  inv[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * invDet;
+  inv[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * invDet;
+  inv[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * invDet;
+  inv[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * invDet;
+
+  // Inverse translation is -(inverse linear part * translation)
+  for (int r = 0; r < 3; ++r) {
+    inv[r][3] = -(inv[r][0] * m[0][3] + inv[r][1] * m[1][3] +
+                  inv[r][2] * m[2][3]);
+  }
+  return Transform(inv);
+}
+
+// Compose two transforms
+Transform Transform::operator*(const Transform& other) const {
+  std::array<std::array<double, 4>, 3> res;
+  for (int r = 0; r < 3; ++r) {
+    for (int c = 0; c < 4; ++c) {
+      res[r][c] = m[r][0] * other.m[0][c] + m[r][1] * other.m[1][c] +
+                  m[r][2] * other.m[2][c];
+    }
+    res[r][3] += m[r][3];
+  }
+  return Transform(res);
+}
+
+// Print transform as Transform([...], [...], [...])
+std::ostream& operator<<(std::ostream& os, const Transform& t) {
+  os << "Transform(";
+  for (int r = 0; r < 3; ++r) {
+    os << "[" << t.m[r][0] << ", " << t.m[r][1] << ", " << t.m[r][2] << ", "
+       << t.m[r][3] << "]" << (r < 2 ? ", " : "");
+  }
+  os << ")";
+  return os;
+}
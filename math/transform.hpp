@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <iostream>
+
+#include "vector.hpp"
+
+// Represents an affine transformation as a 3x4 matrix
+// (3x3 linear part followed by a translation column)
+class Transform {
+ private:
+  std::array<std::array<double, 4>, 3> m;
+
+ public:
+  // Default constructor creates the identity transform
+  Transform();
+  Transform(const std::array<std::array<double, 4>, 3>& mat) : m(mat) {}
+
+  // Factories for common transforms
+  static Transform translate(const Vector& offset);
+  static Transform scale(const Vector& factors);
+  static Transform rotate(const Vector& axis, double degrees);
+
+  Vector applyPoint(const Vector& p) const;
+  Vector applyVector(const Vector& v) const;
+  Vector applyTransposed(const Vector& v) const;
+  double determinant() const;
+  Transform inverse() const;
+
+  // Composition: (a * b) applies b first, then a
+  Transform operator*(const Transform& other) const;
+  double operator()(int row, int col) const { return m[row][col]; }
+
+  friend std::ostream& operator<<(std::ostream& os, const Transform& t);
+
+  ~Transform() = default;
+};
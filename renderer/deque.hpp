@@ -0,0 +1,118 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Lock-free work-stealing deque (Chase-Lev, using the C11 memory orderings
+// from Le et al. 2013, with release stores to bottom in place of the push
+// fence so every bottom a thief reads publishes the items below it)
+// Only the owning thread may push and pop (LIFO at the bottom); any thread
+// may steal (FIFO from the top). Holds pointers; nullptr means empty.
+template <class T>
+class WorkStealingDeque {
+ private:
+  // Circular buffer, replaced by a larger copy when full
+  struct Array {
+    const int64_t capacity;
+    const int64_t mask;
+    std::atomic<T*>* buffer;
+
+    Array(int64_t cap)
+        : capacity(cap), mask(cap - 1), buffer(new std::atomic<T*>[cap]) {}
+
+    T* get(int64_t i) const {
+      return buffer[i & mask].load(std::memory_order_relaxed);
+    }
+    void put(int64_t i, T* x) {
+      buffer[i & mask].store(x, std::memory_order_relaxed);
+    }
+    Array* grow(int64_t bottom, int64_t top) const {
+      Array* bigger = new Array(capacity * 2);
+      for (int64_t i = top; i != bottom; ++i) bigger->put(i, get(i));
+      return bigger;
+    }
+
+    ~Array() { delete[] buffer; }
+  };
+
+  alignas(64) std::atomic<int64_t> top{0};
+  alignas(64) std::atomic<int64_t> bottom{0};
+  alignas(64) std::atomic<Array*> array;
+  std::vector<Array*> retired;  // Old buffers thieves may still be reading
+
+ public:
+  WorkStealingDeque(int64_t capacity = 256) : array(new Array(capacity)) {}
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  // Owner only: push to bottom
+  void push(T* x) {
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_acquire);
+    Array* a = array.load(std::memory_order_relaxed);
+    if (b - t > a->capacity - 1) {
+      retired.push_back(a);
+      a = a->grow(b, t);
+      array.store(a, std::memory_order_release);
+    }
+    a->put(b, x);
+    bottom.store(b + 1, std::memory_order_release);
+  }
+
+  // Owner only: pop most recently pushed item (nullptr if empty)
+  T* pop() {
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    Array* a = array.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      // Deque was empty
+      bottom.store(b + 1, std::memory_order_release);
+      return nullptr;
+    }
+
+    T* x = a->get(b);
+    if (t == b) {
+      // Last item: race against thieves for it
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        x = nullptr;
+      }
+      bottom.store(b + 1, std::memory_order_release);
+    }
+    return x;
+  }
+
+  // Any thread: take oldest item (nullptr if empty or lost a race)
+  T* steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b) return nullptr;
+
+    Array* a = array.load(std::memory_order_acquire);
+    T* x = a->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                     std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return x;
+  }
+
+  // Approximate number of items
+  int64_t size() const {
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+  bool empty() const { return size() == 0; }
+
+  ~WorkStealingDeque() {
+    delete array.load(std::memory_order_relaxed);
+    for (Array* a : retired) delete a;
+  }
+};
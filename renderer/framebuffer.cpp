@@ -0,0 +1,32 @@
+#include "framebuffer.hpp"
+
+FrameBuffer::FrameBuffer(const std::vector<Tile>& tileList)
+    : tiles(tileList), offsets(tileList.size()), slots(tileList.size()) {
+  size_t size = 0;
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    offsets[t] = size;
+    size += 3 * tiles[t].width() * tiles[t].height() * 4;
+  }
+  bytes.resize(size);
+}
+
+// Make the back slot the published one; the old middle becomes the back
+void FrameBuffer::publish(int t, uint64_t gen) {
+  Slots& s = slots[t];
+  const uint64_t old = s.state.exchange(
+      (gen << GEN_SHIFT) | (uint64_t(s.back) << SLOT_SHIFT) | FRESH,
+      std::memory_order_acq_rel);
+  s.back = (old >> SLOT_SHIFT) & 3;
+}
+
+// Make the middle slot the front one if it was published since the last take
+// The old front goes back as the middle, marked taken
+const uint8_t* FrameBuffer::take(int t, uint64_t gen) {
+  Slots& s = slots[t];
+  if (!(s.state.load(std::memory_order_relaxed) & FRESH)) return nullptr;
+  const uint64_t old = s.state.exchange(uint64_t(s.front) << SLOT_SHIFT,
+                                        std::memory_order_acq_rel);
+  s.front = (old >> SLOT_SHIFT) & 3;
+  if ((old >> GEN_SHIFT) != gen) return nullptr;  // Left from an older view
+  return slot(t, s.front);
+}
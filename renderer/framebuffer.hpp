@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "renderer/tiles.hpp"
+
+// Tear-free handoff of finished tiles from the workers to the display
+// Every tile has three slots of RGBA bytes: the writer's back slot, the
+// published middle slot and the reader's front slot. Publishing swaps back
+// and middle, taking swaps middle and front, each with one atomic exchange,
+// so neither side ever waits or touches a slot the other one is using.
+// Writes to a tile must be serialized (tile locks do it), and there is one
+// reader. Alpha 0 marks pixels without samples.
+class FrameBuffer {
+ private:
+  // State word: bit 0 published and not yet taken, bits 1-2 middle slot,
+  // generation of the published slot above
+  static constexpr uint64_t FRESH = 1;
+  static constexpr int SLOT_SHIFT = 1;
+  static constexpr int GEN_SHIFT = 3;
+
+  struct alignas(64) Slots {
+    std::atomic<uint64_t> state{0};  // Middle slot 0, nothing published
+    int back = 1;   // Writer's
+    int front = 2;  // Reader's
+  };
+
+  const std::vector<Tile>& tiles;
+  std::vector<size_t> offsets;  // First byte of each tile's slots
+  std::vector<uint8_t> bytes;
+  std::vector<Slots> slots;
+
+  uint8_t* slot(int t, int index) {
+    const Tile& tile = tiles[t];
+    return &bytes[offsets[t] + index * tile.width() * tile.height() * 4];
+  }
+
+ public:
+  explicit FrameBuffer(const std::vector<Tile>& tileList);
+
+  // Writer: fill back(t) row by row, then publish it
+  uint8_t* back(int t) { return slot(t, slots[t].back); }
+  void publish(int t, uint64_t gen);
+
+  // Reader: newest tile published for gen since the last take, or nullptr
+  const uint8_t* take(int t, uint64_t gen);
+};
@@ -0,0 +1,40 @@
+#include "job.hpp"
+
+#include "math/color.hpp"
+#include "renderer/tracer.hpp"
+
+Job<std::vector<uint8_t>> renderAsync(Scene& sc, int quality,
+                                      Priority priority, ThreadPool& pool) {
+  // Leave the caller's thread before doing any work
+  co_await pool.schedule(priority);
+
+  Pixels pixels(sc.getWidth(), sc.getHeight());
+  Tracer tracer{sc, pool};
+  tracer.prefault(pixels);
+
+  int passes = 0;
+  while (passes < quality) {
+    tracer.renderPass(pixels, priority);
+    passes++;
+    const bool keepGoing = co_yield RenderProgress{passes, quality};
+    if (!keepGoing) break;
+    // Requeue between passes so other jobs on the pool get a turn
+    co_await pool.schedule(priority);
+  }
+
+  // Convert to 8-bit per channel
+  const int w = sc.getWidth();
+  std::vector<uint8_t> image8(sc.getWidth() * sc.getHeight() * 3, 0);
+  if (passes == 0) co_return image8;
+  pool.parallelFor(
+      0, sc.getHeight(), 8,
+      [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+          pixels.resolver.resolveRow(&pixels.pxColors[y * w],
+                                     &pixels.pxSamples[y * w], w,
+                                     &image8[y * w * 3], 3);
+        }
+      },
+      priority);
+  co_return image8;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "pool.hpp"
+#include "scene/scene.hpp"
+
+// Snapshot published by a job after each sample pass
+struct RenderProgress {
+  int passes = 0;       // Passes finished
+  int totalPasses = 0;  // Passes requested
+};
+
+// Coroutine task that runs on pool workers without tying up a thread
+// Starts as soon as it is created. co_yield publishes a progress snapshot
+// and evaluates to false once cancel() was called, so the job can stop at
+// the next pass. Other coroutines co_await the job for its result; plain
+// callers block in get(). Destroying a running job cancels it and waits.
+template <class T>
+class Job {
+ public:
+  struct promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+ private:
+  // Resumes whoever awaits the job, on the thread that finished it
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(Handle h) noexcept {
+      promise_type& p = h.promise();
+      std::coroutine_handle<> next = std::noop_coroutine();
+      // The owner may free the frame as soon as the lock is released
+      std::unique_lock<std::mutex> lock(p.mtx);
+      p.done = true;
+      if (p.continuation) next = p.continuation;
+      p.cv.notify_all();
+      return next;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  // Result of co_yield: true to keep going, false once cancelled
+  struct YieldAwaiter {
+    const promise_type& promise;
+
+    bool await_ready() const noexcept { return true; }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    bool await_resume() const noexcept {
+      return !promise.cancelled.load(std::memory_order_acquire);
+    }
+  };
+
+  // Suspends an awaiting coroutine until the job is done
+  struct Awaiter {
+    Job& job;
+
+    bool await_ready() const { return job.done(); }
+    bool await_suspend(std::coroutine_handle<> h) {
+      promise_type& p = job.handle.promise();
+      std::unique_lock<std::mutex> lock(p.mtx);
+      if (p.done) return false;
+      p.continuation = h;
+      return true;
+    }
+    T await_resume() { return job.take(); }
+  };
+
+  Handle handle;
+
+  explicit Job(Handle h) : handle(h) {}
+
+  // Move the result out (rethrows the job's exception); job must be done
+  T take() {
+    promise_type& p = handle.promise();
+    std::unique_lock<std::mutex> lock(p.mtx);
+    if (p.error) std::rethrow_exception(p.error);
+    return std::move(*p.result);
+  }
+
+ public:
+  struct promise_type {
+    std::mutex mtx;                     // Guards everything below but cancel
+    std::condition_variable cv;         // Signalled when done
+    RenderProgress progress;            // Last published snapshot
+    std::optional<T> result;            // Set by co_return
+    std::exception_ptr error;           // Escaped the coroutine body
+    std::coroutine_handle<> continuation;  // Coroutine awaiting the job
+    bool done = false;
+    std::atomic_bool cancelled{false};
+
+    Job get_return_object() { return Job(Handle::from_promise(*this)); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_value(T value) {
+      std::unique_lock<std::mutex> lock(mtx);
+      result = std::move(value);
+    }
+    void unhandled_exception() {
+      std::unique_lock<std::mutex> lock(mtx);
+      error = std::current_exception();
+    }
+    YieldAwaiter yield_value(const RenderProgress& snapshot) {
+      std::unique_lock<std::mutex> lock(mtx);
+      progress = snapshot;
+      return {*this};
+    }
+  };
+
+  Job(Job&& other) noexcept : handle(std::exchange(other.handle, {})) {}
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+  Job& operator=(Job&&) = delete;
+
+  // Ask the job to stop at its next co_yield
+  void cancel() {
+    handle.promise().cancelled.store(true, std::memory_order_release);
+  }
+
+  bool done() {
+    promise_type& p = handle.promise();
+    std::unique_lock<std::mutex> lock(p.mtx);
+    return p.done;
+  }
+
+  RenderProgress progress() {
+    promise_type& p = handle.promise();
+    std::unique_lock<std::mutex> lock(p.mtx);
+    return p.progress;
+  }
+
+  // Block until the job is done (not from a pool worker: co_await instead)
+  T get() {
+    promise_type& p = handle.promise();
+    {
+      std::unique_lock<std::mutex> lock(p.mtx);
+      p.cv.wait(lock, [&p] { return p.done; });
+    }
+    return take();
+  }
+
+  Awaiter operator co_await() noexcept { return {*this}; }
+
+  ~Job() {
+    if (!handle) return;
+    cancel();
+    promise_type& p = handle.promise();
+    {
+      std::unique_lock<std::mutex> lock(p.mtx);
+      p.cv.wait(lock, [&p] { return p.done; });
+    }
+    handle.destroy();
+  }
+};
+
+// Render sc with quality passes per pixel into 8-bit RGB on pool workers
+// The scene must outlive the job. A cancelled job returns the image of the
+// passes finished so far.
+Job<std::vector<uint8_t>> renderAsync(
+    Scene& sc, int quality, Priority priority = Priority::Refinement,
+    ThreadPool& pool = ThreadPool::shared());
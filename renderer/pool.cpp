@@ -1,88 +1,436 @@
 #include "pool.hpp"
 
+#include <algorithm>
 #include <condition_variable>
 #include <iostream>
 
-// Initialize pool with given number of threads
-ThreadPool::ThreadPool(size_t numThreads) : stop(false) {
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Index of the pool worker running on this thread (-1 if not a worker)
+static thread_local int workerIndex = -1;
+static thread_local const ThreadPool* workerPool = nullptr;
+
+// ----- EventCount -----
+
+// Announce intent to sleep and return the current epoch
+uint64_t ThreadPool::EventCount::prepareWait() {
+  waiters.fetch_add(1, std::memory_order_seq_cst);
+  return epoch.load(std::memory_order_seq_cst);
+}
+
+// Work was found after prepareWait, don't sleep
+void ThreadPool::EventCount::cancelWait() {
+  waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+// Sleep until notify is called after prepareWait returned key
+void ThreadPool::EventCount::commitWait(uint64_t key) {
+  std::unique_lock<std::mutex> lock(mtx);
+  cv.wait(lock, [&] { return epoch.load(std::memory_order_seq_cst) != key; });
+  waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+// Wake up to count parked workers (cheap when nobody is waiting)
+void ThreadPool::EventCount::notify(int count) {
+  epoch.fetch_add(1, std::memory_order_seq_cst);
+  const int sleeping = waiters.load(std::memory_order_seq_cst);
+  if (sleeping == 0 || count <= 0) return;
+  {
+    // Taking the lock orders this with a waiter's epoch check in commitWait
+    std::unique_lock<std::mutex> lock(mtx);
+  }
+  if (count >= sleeping) {
+    cv.notify_all();
+  } else {
+    for (int i = 0; i < count; ++i) cv.notify_one();
+  }
+}
+
+// ----- Spinning -----
+
+// Tell the CPU this is a spin-wait loop (saves power, frees the sibling
+// hyperthread)
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// ----- Telemetry -----
+
+static inline uint64_t nowNanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Add to a counter only its worker writes: no read-modify-write needed
+static inline void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+// ----- Affinity -----
+
+// CPUs this process may run on, in order
+static std::vector<int> allowedCpus() {
+  std::vector<int> cpus;
+#ifdef __linux__
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+// Restrict a thread to a single CPU
+static void pinThread(std::thread& thread, int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+    std::cerr << "Failed to pin worker to CPU " << cpu << std::endl;
+  }
+#else
+  (void)thread;
+  (void)cpu;
+#endif
+}
+
+// ----- ThreadPool -----
+
+// Initialize pool with given number of threads, optionally pinned to CPUs
+ThreadPool::ThreadPool(size_t numThreads, bool pinWorkers) : stop(false) {
+  numThreads = std::max<size_t>(numThreads, 1);
   for (size_t i = 0; i < numThreads; ++i) {
-    workers.emplace_back([this] {
-      while (true) {
-        std::function<void()> task;
-        {
-          // Acquire lock and wait for tasks
-          std::unique_lock<std::mutex> lock(this->mtx);
-          cv.wait(lock, [this] { return stop || !tasks.empty(); });
-          if (this->stop && this->tasks.empty()) return;
-          task = std::move(this->tasks.front());
-          this->tasks.pop();
-          active++;
-        }
-        task();
-        // Mark task as done
-        {
-          std::unique_lock<std::mutex> lock(this->mtx);
-          active--;
-          if (active == 0 && tasks.empty()) cvFinished.notify_all();
-        }
-      }
-    });
+    workers.push_back(std::make_unique<Worker>());
+  }
+  // Start threads only once every deque exists (workers steal from all)
+  for (size_t i = 0; i < numThreads; ++i) {
+    workers[i]->thread = std::thread([this, i] { workerLoop(i); });
   }
+
+  // Worker i gets the CPU after the first, which is left to the main thread
+  const std::vector<int> cpus = pinWorkers ? allowedCpus() : std::vector<int>();
+  for (size_t i = 0; i < numThreads && !cpus.empty(); ++i) {
+    pinThread(workers[i]->thread, cpus[(i + 1) % cpus.size()]);
+  }
+}
+
+// Process-wide pool, started on first use and shared by every tracer, image
+// and BVH build that isn't given a pool of its own
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool(defaultSize());
+  return pool;
+}
+
+// One worker per hardware thread, minus one for the main (SDL) thread
+size_t ThreadPool::defaultSize() {
+  const size_t hw = std::thread::hardware_concurrency();
+  return hw > 1 ? hw - 1 : 1;
+}
+
+// Check if pinWorkers has an effect on this platform
+bool ThreadPool::pinningSupported() {
+#ifdef __linux__
+  return true;
+#else
+  return false;
+#endif
 }
 
 // Destructor: join all threads
 ThreadPool::~ThreadPool() {
-  {
-    std::unique_lock<std::mutex> lock(mtx);
-    stop = true;
-  }
-  cv.notify_all();
-  for (std::thread& worker : workers) {
-    if (worker.joinable()) {
-      worker.join();
+  stop = true;
+  workAvailable.notify(workers.size());
+  for (std::unique_ptr<Worker>& worker : workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
     }
   }
 }
 
-// Get number of pending tasks
-int ThreadPool::numTasks() {
-  std::unique_lock<std::mutex> lock(mtx);
-  return tasks.size();
+// Take the injector lock, timing the wait only when it is contended
+void ThreadPool::lockInjector(std::unique_lock<std::mutex>& lock) {
+  if (lock.try_lock()) return;
+  const uint64_t start = nowNanos();
+  lock.lock();
+  const uint64_t waited = nowNanos() - start;
+  if (workerPool == this) {
+    bump(workers[workerIndex]->counters.lockWaitNanos, waited);
+  } else {
+    submitLockWaitNanos.fetch_add(waited, std::memory_order_relaxed);
+  }
 }
 
-// Check if abort flag is set
-bool ThreadPool::shouldAbort() {
-  return abortAll.load(std::memory_order_acquire);
+// Queue a task in its lane: workers push to their own deque, other threads
+// to the injector
+void ThreadPool::submit(Task* task) {
+  const int lane = static_cast<int>(task->priority);
+  queued.fetch_add(1, std::memory_order_relaxed);
+  laneQueued[lane].fetch_add(1, std::memory_order_relaxed);
+  pending.fetch_add(1, std::memory_order_relaxed);
+
+  if (workerPool == this) {
+    workers[workerIndex]->tasks[lane].push(task);
+  } else {
+    std::unique_lock<std::mutex> lock(injectorMtx, std::defer_lock);
+    lockInjector(lock);
+    injector[lane].push_back(task);
+  }
+  // A spinning worker picks it up without being woken
+  if (spinning.load(std::memory_order_seq_cst) == 0) workAvailable.notify(1);
 }
 
-// Wait for all tasks to finish
-void ThreadPool::wait() {
-  std::unique_lock<std::mutex> lock(mtx);
-  cvFinished.wait(lock, [this] { return tasks.empty() && active == 0; });
+// Queue several tasks, waking only as many workers as aren't spinning
+void ThreadPool::submitAll(const std::vector<Task*>& tasks) {
+  if (tasks.empty()) return;
+  const int n = tasks.size();
+  queued.fetch_add(n, std::memory_order_relaxed);
+  pending.fetch_add(n, std::memory_order_relaxed);
+  for (Task* task : tasks) {
+    laneQueued[static_cast<int>(task->priority)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  if (workerPool == this) {
+    for (Task* task : tasks) {
+      workers[workerIndex]->tasks[static_cast<int>(task->priority)].push(task);
+    }
+  } else {
+    std::unique_lock<std::mutex> lock(injectorMtx, std::defer_lock);
+    lockInjector(lock);
+    for (Task* task : tasks) {
+      injector[static_cast<int>(task->priority)].push_back(task);
+    }
+  }
+  workAvailable.notify(n - spinning.load(std::memory_order_seq_cst));
 }
 
-// Clear all pending tasks and abort active ones
-void ThreadPool::clearTasks() {
-  {
-    std::unique_lock<std::mutex> lock(mtx);
-    abortAll = true;
-    // Clear pending tasks
-    std::queue<std::function<void()>> empty;
-    std::swap(tasks, empty);
+// Check if any lane below the given one has tasks waiting
+bool ThreadPool::lowerLaneWaiting(int lane) const {
+  for (int l = lane + 1; l < NUM_LANES; ++l) {
+    if (laneQueued[l].load(std::memory_order_relaxed) > 0) return true;
   }
+  return false;
+}
 
-  // Wake all workers so they notice abortAll
-  cv.notify_all();
+// Find a task, highest lane first
+// After STARVATION_LIMIT picks that skipped waiting lower lanes, search the
+// lanes lowest first once so bulk work keeps moving
+ThreadPool::Task* ThreadPool::findTask(int index) {
+  Worker& self = *workers[index];
+  const bool starving = self.streak >= STARVATION_LIMIT;
 
-  // Wait until all active tasks exit early
-  {
-    std::unique_lock<std::mutex> lock(mtx);
-    cvFinished.wait(lock, [this] { return active == 0; });
+  for (int i = 0; i < NUM_LANES; ++i) {
+    const int lane = starving ? NUM_LANES - 1 - i : i;
+    if (Task* task = findTaskInLane(index, lane)) {
+      if (!starving && lowerLaneWaiting(lane)) {
+        self.streak++;
+      } else {
+        self.streak = 0;
+      }
+      return task;
+    }
   }
+  return nullptr;
+}
+
+// Find a task in one lane: own deque first, then a batch from injector, then
+// steal
+ThreadPool::Task* ThreadPool::findTaskInLane(int index, int lane) {
+  WorkStealingDeque<Task>& own = workers[index]->tasks[lane];
+  Counters& counters = workers[index]->counters;
+  if (Task* task = own.pop()) return task;
 
-  // reset abort flag; pool can accept new tasks
   {
-    std::unique_lock<std::mutex> lock(mtx);
-    abortAll = false;
+    std::unique_lock<std::mutex> lock(injectorMtx, std::defer_lock);
+    lockInjector(lock);
+    std::deque<Task*>& shared = injector[lane];
+    if (!shared.empty()) {
+      // Take a share of the injector and keep the extras locally
+      const size_t batch = std::clamp(shared.size() / workers.size(),
+                                      size_t{1}, MAX_INJECT_BATCH);
+      Task* task = shared.front();
+      shared.pop_front();
+      for (size_t i = 1; i < batch; ++i) {
+        own.push(shared.front());
+        shared.pop_front();
+      }
+      bump(counters.injected, batch);
+      return task;
+    }
   }
-}
\ No newline at end of file
+
+  // Steal from other workers, starting with the next one over
+  const int n = workers.size();
+  for (int i = 1; i < n; ++i) {
+    WorkStealingDeque<Task>& victim = workers[(index + i) % n]->tasks[lane];
+    while (!victim.empty()) {
+      if (Task* task = victim.steal()) {
+        bump(counters.steals);
+        return task;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// Run and free a task, then update counters (workers only)
+void ThreadPool::runTask(Task* task) {
+  bump(workers[workerIndex]->counters.tasks);
+  queued.fetch_sub(1, std::memory_order_relaxed);
+  laneQueued[static_cast<int>(task->priority)].fetch_sub(
+      1, std::memory_order_relaxed);
+  task->execute();
+  if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::unique_lock<std::mutex> lock(finishedMtx);
+    cvFinished.notify_all();
+  }
+}
+
+// Check if the calling thread is one of this pool's workers
+bool ThreadPool::onWorker() const { return workerPool == this; }
+
+// Wait for a forked task on a worker: pop it back if nobody stole it,
+// otherwise help with other work until the thief finishes it
+void ThreadPool::join(const std::atomic_bool& done) {
+  while (!done.load(std::memory_order_acquire)) {
+    if (Task* task = findTask(workerIndex)) {
+      runTask(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+// Poll for work until the spin budget runs out, touching only counters
+// between attempts
+ThreadPool::Task* ThreadPool::spinForTask(int index) {
+  const int64_t budget = spinMicros.load(std::memory_order_relaxed);
+  if (budget <= 0) return nullptr;
+
+  spinning.fetch_add(1, std::memory_order_seq_cst);
+  const auto start = std::chrono::steady_clock::now();
+  const auto deadline = start + std::chrono::microseconds(budget);
+  Task* task = nullptr;
+  while (!stop.load(std::memory_order_relaxed)) {
+    if (queued.load(std::memory_order_relaxed) > 0) {
+      if ((task = findTask(index))) break;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) break;
+    for (int i = 0; i < PAUSES_PER_POLL; ++i) cpuRelax();
+  }
+
+  // Submitters skipped the wakeup while we spun: pass it on if work is left
+  if (spinning.fetch_sub(1, std::memory_order_seq_cst) == 1 && task &&
+      queued.load(std::memory_order_relaxed) > 0) {
+    workAvailable.notify(1);
+  }
+
+  Counters& counters = workers[index]->counters;
+  bump(counters.spinNanos,
+       std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now() - start)
+           .count());
+  if (task) bump(counters.spinHits);
+  return task;
+}
+
+// Main loop of a worker: run tasks until stopped, spinning then parking when
+// idle
+void ThreadPool::workerLoop(int index) {
+  workerIndex = index;
+  workerPool = this;
+  Counters& counters = workers[index]->counters;
+  bool woken = false;
+
+  // Nested tasks run inside this, so busy time is only counted here
+  auto run = [&](Task* task) {
+    const uint64_t start = nowNanos();
+    runTask(task);
+    bump(counters.busyNanos, nowNanos() - start);
+  };
+
+  while (true) {
+    if (Task* task = findTask(index)) {
+      // Chain wakeups through a burst: a woken worker wakes the next one
+      if (woken && queued.load(std::memory_order_relaxed) > 0) {
+        workAvailable.notify(1);
+      }
+      woken = false;
+      run(task);
+      continue;
+    }
+    if (Task* task = spinForTask(index)) {
+      run(task);
+      continue;
+    }
+
+    // Re-check after announcing the wait so a concurrent submit is not missed
+    const uint64_t key = workAvailable.prepareWait();
+    if (Task* task = findTask(index)) {
+      workAvailable.cancelWait();
+      run(task);
+      continue;
+    }
+    if (stop) {
+      workAvailable.cancelWait();
+      return;
+    }
+    const uint64_t parkedAt = nowNanos();
+    bump(counters.parks);
+    workAvailable.commitWait(key);
+    bump(counters.parkedNanos, nowNanos() - parkedAt);
+    woken = true;
+  }
+}
+
+// Get number of pending tasks
+int ThreadPool::numTasks() { return queued.load(std::memory_order_relaxed); }
+
+// Copy out every worker's counters and the pool-wide ones
+// Counters are read one by one while workers run, so totals may be a task
+// or two apart
+PoolStats ThreadPool::stats() const {
+  PoolStats snapshot;
+  for (const std::unique_ptr<Worker>& worker : workers) {
+    const Counters& c = worker->counters;
+    WorkerStats w;
+    w.tasks = c.tasks.load(std::memory_order_relaxed);
+    w.steals = c.steals.load(std::memory_order_relaxed);
+    w.injected = c.injected.load(std::memory_order_relaxed);
+    w.spinHits = c.spinHits.load(std::memory_order_relaxed);
+    w.parks = c.parks.load(std::memory_order_relaxed);
+    w.busyNanos = c.busyNanos.load(std::memory_order_relaxed);
+    w.spinNanos = c.spinNanos.load(std::memory_order_relaxed);
+    w.parkedNanos = c.parkedNanos.load(std::memory_order_relaxed);
+    w.lockWaitNanos = c.lockWaitNanos.load(std::memory_order_relaxed);
+    snapshot.workers.push_back(w);
+  }
+  snapshot.queued = queued.load(std::memory_order_relaxed);
+  for (int lane = 0; lane < NUM_LANES; ++lane) {
+    snapshot.laneQueued[lane] =
+        laneQueued[lane].load(std::memory_order_relaxed);
+  }
+  snapshot.submitLockWaitNanos =
+      submitLockWaitNanos.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+// Wait for all tasks to finish
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(finishedMtx);
+  cvFinished.wait(lock, [this] {
+    return pending.load(std::memory_order_acquire) == 0;
+  });
+}
@@ -1,39 +1,286 @@
 #pragma once
 
-#include <functional>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
-// Simple thread pool for parallel task execution
+#include "renderer/deque.hpp"
+#include "renderer/telemetry.hpp"
+
+// Scheduling lanes, highest first
+// Interactive: work the user is waiting on (first pass after a camera move)
+// Refinement: bulk progressive sampling
+// Background: work that can wait (I/O)
+enum class Priority { Interactive, Refinement, Background };
+
+// Work-stealing thread pool for parallel task execution
+// Each worker owns a deque: it pushes and pops its own tasks LIFO while idle
+// workers steal FIFO from others. Tasks enqueued from outside the pool go
+// through a shared injection queue that workers drain in batches.
+// parallelFor and parallelReduce split a range recursively (fork-join): each
+// split pushes the right half as a task on the forking thread's stack, so
+// chunks cost no allocation, and the caller waits only for its own range.
+// Workers can be pinned to one CPU each so they stop migrating (Linux only).
+// Every lane has its own queues and higher lanes are drained first; a worker
+// that keeps passing over lower lanes with work serves them once in a while.
+// Idle workers spin briefly before parking, so tasks arriving in bursts start
+// without a futex wakeup; submitters skip the wakeup while someone spins.
+// Coroutines co_await schedule() to continue on a worker.
+// Each worker keeps its own scheduler counters; stats() adds them up.
 class ThreadPool {
  private:
-  std::vector<std::thread> workers;         // Worker threads
-  std::queue<std::function<void()>> tasks;  // Task queue
-  std::mutex mtx;                           // Mutex for task queue
-  std::condition_variable cv;               // Task available condition
-  std::condition_variable cvFinished;       // All tasks finished condition
-  std::atomic<int> active{0};               // Active task count
-  std::atomic_bool abortAll{false};         // Flag to abort all tasks
-  std::atomic_bool stop{false};             // Destruction flag
+  static constexpr size_t MAX_INJECT_BATCH = 32;  // Tasks taken per lock
+  static constexpr int NUM_LANES = 3;             // One per Priority
+  static constexpr int STARVATION_LIMIT = 32;  // Higher lane picks in a row
+  static constexpr int PAUSES_PER_POLL = 16;    // CPU pauses between polls
+
+  // Unit of work in the queues
+  struct Task {
+    Priority priority = Priority::Refinement;
+
+    virtual ~Task() = default;
+    virtual void execute() = 0;
+  };
+
+  // Heap task from enqueue, frees itself once run
+  template <class F>
+  struct FunctionTask final : Task {
+    F func;
+
+    explicit FunctionTask(F&& f) : func(std::move(f)) {}
+    explicit FunctionTask(const F& f) : func(f) {}
+    void execute() override {
+      func();
+      delete this;
+    }
+  };
+
+  // Resumes a coroutine suspended on schedule()
+  struct ResumeTask final : Task {
+    std::coroutine_handle<> handle;
+
+    explicit ResumeTask(std::coroutine_handle<> h) : handle(h) {}
+    void execute() override {
+      const std::coroutine_handle<> h = handle;
+      delete this;
+      h.resume();
+    }
+  };
+
+  // Lets a thread outside the pool sleep until its fork-join root finishes
+  struct Completion {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool done = false;
+  };
+
+  // Right half of a split range, computed by whichever thread gets it first
+  template <class T, class Body, class Combine>
+  struct RangeTask final : Task {
+    ThreadPool& pool;
+    const int begin, end, grain;
+    const Body& body;
+    const Combine& combine;
+    T result{};
+    std::atomic_bool done{false};
+    Completion* completion = nullptr;  // Set when waited on from outside
+
+    RangeTask(ThreadPool& p, int b, int e, int g, const Body& bd,
+              const Combine& c)
+        : pool(p), begin(b), end(e), grain(g), body(bd), combine(c) {}
+
+    void execute() override {
+      result = pool.forkJoin<T>(begin, end, grain, body, combine, priority);
+      if (completion) {
+        // Notify under the lock: the waiter owns this task and may free it
+        std::unique_lock<std::mutex> lock(completion->mtx);
+        completion->done = true;
+        completion->cv.notify_all();
+      } else {
+        done.store(true, std::memory_order_release);
+      }
+    }
+  };
+
+  struct NoResult {};
+
+  // Lets sleeping workers park without missing a wakeup: a worker reads the
+  // epoch, re-checks for work, then sleeps only if the epoch is unchanged
+  class EventCount {
+   private:
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<int> waiters{0};
+    std::mutex mtx;
+    std::condition_variable cv;
+
+   public:
+    uint64_t prepareWait();
+    void cancelWait();
+    void commitWait(uint64_t key);
+    void notify(int count);
+  };
+
+  // Written only by the owning worker, read by stats() from any thread
+  // Own cache lines so counting never contends with the deques or neighbours
+  struct alignas(64) Counters {
+    std::atomic<uint64_t> tasks{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> injected{0};
+    std::atomic<uint64_t> spinHits{0};
+    std::atomic<uint64_t> parks{0};
+    std::atomic<uint64_t> busyNanos{0};
+    std::atomic<uint64_t> spinNanos{0};
+    std::atomic<uint64_t> parkedNanos{0};
+    std::atomic<uint64_t> lockWaitNanos{0};
+  };
+
+  struct Worker {
+    WorkStealingDeque<Task> tasks[NUM_LANES];
+    std::thread thread;
+    int streak = 0;  // Tasks taken while a lower lane had work
+    Counters counters;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;  // Worker threads and deques
+  std::deque<Task*> injector[NUM_LANES];         // Tasks from outside pool
+  std::mutex injectorMtx;                        // Mutex for injector
+  EventCount workAvailable;                      // Parks idle workers
+  std::mutex finishedMtx;                        // Mutex for cvFinished
+  std::condition_variable cvFinished;            // All tasks finished
+  std::atomic<int> queued{0};                    // Tasks not yet started
+  std::atomic<int> laneQueued[NUM_LANES] = {};   // Tasks not started per lane
+  std::atomic<int> pending{0};                   // Tasks not yet finished
+  std::atomic_bool stop{false};                  // Destruction flag
+  std::atomic<int> spinning{0};                  // Workers spinning for work
+  std::atomic<int64_t> spinMicros{50};           // Spin budget before parking
+  std::atomic<uint64_t> submitLockWaitNanos{0};  // Outside threads on lock
+
+  void lockInjector(std::unique_lock<std::mutex>& lock);
+  void submit(Task* task);
+  void submitAll(const std::vector<Task*>& tasks);
+  void workerLoop(int index);
+  Task* spinForTask(int index);
+  Task* findTask(int index);
+  Task* findTaskInLane(int index, int lane);
+  bool lowerLaneWaiting(int lane) const;
+  void runTask(Task* task);
+  bool onWorker() const;
+  void join(const std::atomic_bool& done);
+
+  // Split [begin, end) in halves down to grain, forking the right halves
+  template <class T, class Body, class Combine>
+  T forkJoin(int begin, int end, int grain, const Body& body,
+             const Combine& combine, Priority priority) {
+    if (end - begin <= grain) return body(begin, end);
+
+    const int mid = begin + (end - begin) / 2;
+    RangeTask<T, Body, Combine> right(*this, mid, end, grain, body, combine);
+    right.priority = priority;
+    submit(&right);
+    T left = forkJoin<T>(begin, mid, grain, body, combine, priority);
+    join(right.done);
+    return combine(std::move(left), std::move(right.result));
+  }
 
  public:
-  ThreadPool(size_t numThreads);
+  ThreadPool(size_t numThreads, bool pinWorkers = false);
   ~ThreadPool();
 
+  static ThreadPool& shared();
+  static size_t defaultSize();
+  static bool pinningSupported();
+
   template <class F>
-  void enqueue(F&& f) {
-    {
-      std::unique_lock<std::mutex> lock(mtx);
-      tasks.emplace(std::forward<F>(f));
+  void enqueue(F&& f, Priority priority = Priority::Refinement) {
+    Task* task = new FunctionTask<std::decay_t<F>>(std::forward<F>(f));
+    task->priority = priority;
+    submit(task);
+  }
+
+  // Queue a batch of callables with one lock and one round of wakeups
+  template <class It>
+  void enqueueAll(It first, It last, Priority priority = Priority::Refinement) {
+    using F = std::decay_t<decltype(*first)>;
+    std::vector<Task*> tasks;
+    for (; first != last; ++first) {
+      tasks.push_back(new FunctionTask<F>(*first));
+      tasks.back()->priority = priority;
+    }
+    submitAll(tasks);
+  }
+
+  // Combine body(b, e) over chunks of at most grain indices in [begin, end)
+  // Blocks until the whole range is done; safe to call from inside the pool
+  template <class T, class Body, class Combine>
+  T parallelReduce(int begin, int end, int grain, T identity,
+                   const Body& body, const Combine& combine,
+                   Priority priority = Priority::Refinement) {
+    if (begin >= end) return identity;
+    grain = std::max(grain, 1);
+    if (onWorker()) {
+      return forkJoin<T>(begin, end, grain, body, combine, priority);
     }
-    cv.notify_one();
+
+    // Outside the pool: hand the root to a worker and sleep until it is done
+    Completion completion;
+    RangeTask<T, Body, Combine> root(*this, begin, end, grain, body, combine);
+    root.priority = priority;
+    root.completion = &completion;
+    submit(&root);
+    std::unique_lock<std::mutex> lock(completion.mtx);
+    completion.cv.wait(lock, [&] { return completion.done; });
+    return std::move(root.result);
+  }
+
+  // Run body(b, e) over chunks of at most grain indices in [begin, end)
+  template <class Body>
+  void parallelFor(int begin, int end, int grain, const Body& body,
+                   Priority priority = Priority::Refinement) {
+    parallelReduce(
+        begin, end, grain, NoResult{},
+        [&body](int b, int e) {
+          body(b, e);
+          return NoResult{};
+        },
+        [](NoResult, NoResult) { return NoResult{}; }, priority);
+  }
+
+  // co_await pool.schedule() moves the awaiting coroutine onto a worker
+  struct Schedule {
+    ThreadPool& pool;
+    const Priority priority;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      Task* task = new ResumeTask(h);
+      task->priority = priority;
+      pool.submit(task);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  Schedule schedule(Priority priority = Priority::Refinement) {
+    return {*this, priority};
+  }
+
+  // How long idle workers spin before parking (0 parks at once)
+  void setSpinTime(std::chrono::microseconds time) {
+    spinMicros.store(time.count(), std::memory_order_relaxed);
   }
 
   int size() const { return workers.size(); }
   int numTasks();
+  PoolStats stats() const;
 
-  bool shouldAbort();
   void wait();
-  void clearTasks();
-};
\ No newline at end of file
+};
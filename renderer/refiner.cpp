@@ -0,0 +1,142 @@
+#include "refiner.hpp"
+
+Refiner::Refiner(Tracer& tr, Pixels& px)
+    : tracer(tr),
+      pixels(px),
+      numTiles(px.numTiles()),
+      maxInFlight(TILES_PER_WORKER * tr.pool.size()),
+      rays(tr.rayGenerator()),
+      tileBusyGen(px.numTiles(), 0),
+      costPerSample(px.numTiles(), 0.0),
+      lastSamples(px.numTiles(), 0) {}
+
+// Begin refining the current generation until stopped
+void Refiner::start() {
+  std::unique_lock<std::mutex> lock(mtx);
+  running = true;
+  lock.unlock();
+  restart();
+}
+
+// Start over from the first tile with the current camera and pixel generation
+// Call from the thread that moves the camera, after invalidating the pixels
+void Refiner::restart() {
+  std::unique_lock<std::mutex> lock(mtx);
+  rays = tracer.rayGenerator();
+  generation = pixels.currentGeneration();
+  cursor = 0;
+  cycle = 0;
+  completedTiles = 0;
+  dispatch();
+}
+
+// Stop queueing tiles and wait for the ones in flight
+void Refiner::stop() {
+  std::unique_lock<std::mutex> lock(mtx);
+  running = false;
+  cvIdle.wait(lock, [this] { return inFlight == 0; });
+}
+
+// Number of full passes finished in the current generation
+int Refiner::completedPasses() {
+  std::unique_lock<std::mutex> lock(mtx);
+  return numTiles > 0 ? completedTiles / numTiles : 0;
+}
+
+// Camera of the generation being refined
+RayGenerator Refiner::view() {
+  std::unique_lock<std::mutex> lock(mtx);
+  return rays;
+}
+
+// Only queue work expected to fit in budget per frame (0 turns it off)
+void Refiner::setFrameBudget(std::chrono::duration<double> budget) {
+  std::unique_lock<std::mutex> lock(mtx);
+  frameBudget = budget.count();
+  credit = frameBudget * tracer.pool.size();
+}
+
+// Start a frame: grant the workers the frame budget and queue tiles into it
+// Time left over from the last frame is not carried, so work never bunches
+void Refiner::beginFrame() {
+  std::unique_lock<std::mutex> lock(mtx);
+  if (frameBudget <= 0.0) return;
+  credit = frameBudget * tracer.pool.size();
+  dispatch();
+}
+
+// Expected seconds for the tile's next pass (mtx must be held)
+// A tile never timed borrows the mean cost; with no timings at all it takes
+// what is left of the frame, so the first frame probes a tile per grant
+double Refiner::estimate(int tile) const {
+  const Tile& t = pixels.tiles[tile];
+  const int samples = lastSamples[tile] > 0 ? lastSamples[tile]
+                                            : t.width() * t.height();
+  if (costPerSample[tile] > 0.0) return costPerSample[tile] * samples;
+  if (meanCostPerSample > 0.0) return meanCostPerSample * samples;
+  return credit;
+}
+
+// Queue tiles until the in-flight limit is reached (mtx must be held)
+// Stops at a tile still being refined for this generation rather than
+// passing it, so every tile gets its next pass before any gets two
+void Refiner::dispatch() {
+  auto advance = [this] {
+    if (++cursor == numTiles) {
+      cursor = 0;
+      cycle++;
+    }
+  };
+
+  while (running && inFlight < maxInFlight) {
+    // Converged tiles are done for this generation
+    int skipped = 0;
+    while (skipped < numTiles && pixels.tileConverged(cursor)) {
+      advance();
+      skipped++;
+    }
+    if (skipped == numTiles) return;                // Image converged
+    if (tileBusyGen[cursor] == generation) return;  // Refilled when done
+    if (frameBudget > 0.0) {
+      if (credit <= 0.0) return;  // Refilled next frame
+      credit -= estimate(cursor);
+    }
+
+    const int tile = cursor;
+    // First sweep of a new view goes ahead of background refinement
+    const Priority priority =
+        cycle == 0 ? Priority::Interactive : Priority::Refinement;
+    advance();
+
+    tileBusyGen[tile] = generation;
+    inFlight++;
+    tracer.pool.enqueue(
+        [this, tile, rays = rays, gen = generation] {
+          const auto start = std::chrono::steady_clock::now();
+          const int samples = tracer.renderTile(pixels, rays, gen, tile);
+          const std::chrono::duration<double> elapsed =
+              std::chrono::steady_clock::now() - start;
+          tileDone(tile, gen, elapsed.count(), samples);
+        },
+        priority);
+  }
+}
+
+// Release a finished tile, learn its cost and refill the queue
+void Refiner::tileDone(int tile, uint64_t gen, double seconds, int samples) {
+  traced.fetch_add(samples, std::memory_order_relaxed);
+  std::unique_lock<std::mutex> lock(mtx);
+  if (samples > 0) {
+    auto smooth = [](double& avg, double value) {
+      avg = avg > 0.0 ? avg + COST_SMOOTHING * (value - avg) : value;
+    };
+    smooth(costPerSample[tile], seconds / samples);
+    smooth(meanCostPerSample, seconds / samples);
+    if (gen == generation) lastSamples[tile] = samples;  // Else cut short
+  }
+  if (tileBusyGen[tile] == gen) tileBusyGen[tile] = 0;
+  if (gen == generation) completedTiles++;
+  inFlight--;
+  dispatch();
+  if (inFlight == 0) cvIdle.notify_all();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "math/raygen.hpp"
+#include "renderer/tracer.hpp"
+
+// Progressive refinement scheduler
+// Keeps a bounded number of tile tasks in flight and queues the next tile
+// only when one finishes, so queue memory stays flat. Tiles are handed out in
+// a cycle in the pixels' tile order, so sample counts stay within one pass of
+// each other. The first cycle after a restart runs at interactive priority.
+// With adaptive sampling, converged tiles are skipped and the refiner goes
+// idle once the whole image has converged.
+// With a frame budget, each beginFrame() grants the workers that much time
+// and tiles are queued only while their estimated cost fits in what is left.
+// Costs are learned per tile as seconds per sample, times the samples the
+// tile took last pass (fewer once adaptive sampling settles pixels).
+class Refiner {
+ private:
+  static constexpr int TILES_PER_WORKER = 2;  // Tiles in flight per worker
+  static constexpr double COST_SMOOTHING = 0.25;  // Weight of the last pass
+
+  Tracer& tracer;
+  Pixels& pixels;
+  const int numTiles;
+  const int maxInFlight;
+
+  std::mutex mtx;                     // Guards everything below
+  std::condition_variable cvIdle;     // No tiles in flight
+  RayGenerator rays;                  // Camera of the current generation
+  uint64_t generation = 0;            // Generation being refined
+  std::vector<uint64_t> tileBusyGen;  // Generation in flight per tile (0 none)
+  int cursor = 0;                     // Next tile to hand out
+  int cycle = 0;                      // Full cycles handed out this generation
+  int completedTiles = 0;             // Tiles finished this generation
+  int inFlight = 0;                   // Tile tasks queued or running
+  bool running = false;
+
+  double frameBudget = 0.0;            // Seconds per frame, 0 no deadline
+  double credit = 0.0;                 // Worker-seconds left this frame
+  std::vector<double> costPerSample;   // Seconds per sample per tile, 0 unknown
+  std::vector<int> lastSamples;        // Samples of each tile's last pass
+  double meanCostPerSample = 0.0;      // Over all tiles, 0 unknown
+  std::atomic<uint64_t> traced{0};     // Samples traced by tile tasks
+
+  void dispatch();
+  double estimate(int tile) const;
+  void tileDone(int tile, uint64_t gen, double seconds, int samples);
+
+ public:
+  Refiner(Tracer& tr, Pixels& px);
+
+  void start();
+  void restart();
+  void stop();
+  int completedPasses();
+  RayGenerator view();
+
+  void setFrameBudget(std::chrono::duration<double> budget);
+  void beginFrame();
+  uint64_t samplesTraced() const {
+    return traced.load(std::memory_order_relaxed);
+  }
+
+  ~Refiner() { stop(); }
+};
@@ -1,30 +1,63 @@
 #include "renderer.hpp"
 
+#include <chrono>
 #include <condition_variable>
+#include <thread>
 
 #include "SDL.h"
 #include "io/image.hpp"
 #include "math/color.hpp"
 
+// Copy tiles published since the last frame and upload only those
 void Renderer::updateImage8() {
   const int w = scene.getWidth();
-  const int h = scene.getHeight();
-
-  for (int y = 0; y < h; ++y) {
-    if (backPixels.rowReady[y].load(std::memory_order_acquire)) {
-      for (int x = 0; x < w; ++x) {
-        const int i = y * w + x;
-        const Color& col = backPixels.pxColors[i] /
-                           static_cast<double>(backPixels.pxSamples[i]);
-        const int rIndex = i * 3;
-        const auto bytes = col.clamp().getBytes();
-        image8[rIndex] = bytes[0];
-        image8[rIndex + 1] = bytes[1];
-        image8[rIndex + 2] = bytes[2];
+  const uint64_t gen = backPixels.currentGeneration();
+
+  for (int t = 0; t < backPixels.numTiles(); ++t) {
+    // Only show tiles finished for the current generation
+    const uint8_t* rgba = backPixels.frames->take(t, gen);
+    if (!rgba) continue;
+    const Tile& tile = backPixels.tiles[t];
+    for (int y = tile.y0; y < tile.y1; ++y) {
+      for (int x = tile.x0; x < tile.x1; ++x, rgba += 4) {
+        // Keep the motion frame where reprojection left no samples
+        if (rgba[3] == 0) continue;
+        const int rIndex = (y * w + x) * 3;
+        image8[rIndex] = rgba[0];
+        image8[rIndex + 1] = rgba[1];
+        image8[rIndex + 2] = rgba[2];
       }
-      backPixels.rowReady[y].store(false, std::memory_order_release);
     }
+    const SDL_Rect rect{tile.x0, tile.y0, tile.width(), tile.height()};
+    SDL_UpdateTexture(texture, &rect, &image8[(tile.y0 * w + tile.x0) * 3],
+                      w * 3);
+  }
+}
+
+// Trace the moved view in one pass at the scaler's resolution and show it
+// upsampled; the frame's time sets the resolution of the next one
+// Returns the number of samples traced
+uint64_t Renderer::renderMotionFrame() {
+  const int w = scene.getWidth();
+  const int h = scene.getHeight();
+  const int factor = scaler.factor();
+  const auto start = std::chrono::steady_clock::now();
+
+  std::unique_ptr<Pixels>& low = motionPixels[factor];
+  if (!low) {
+    low = std::make_unique<Pixels>((w + factor - 1) / factor,
+                                   (h + factor - 1) / factor);
+    low->resolver = Resolver(toneMapping);
   }
+  low->invalidate();
+  tracer.renderPass(*low, Priority::Interactive, factor);
+  upsample(*low, factor, w, h, image8, tracer.pool);
+
+  scaler.update(std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+  SDL_UpdateTexture(texture, nullptr, image8.data(), w * 3);
+  return static_cast<uint64_t>(low->width) * low->height;
 }
 
 void Renderer::run() {
@@ -37,14 +70,27 @@ void Renderer::run() {
   sdlRenderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
   texture = SDL_CreateTexture(sdlRenderer, SDL_PIXELFORMAT_RGB24,
                               SDL_TEXTUREACCESS_STREAMING, w, h);
+  SDL_UpdateTexture(texture, nullptr, image8.data(), w * 3);
 
   bool running = true;
   bool rotating = false;
   SDL_Event event;
 
+  using Clock = std::chrono::steady_clock;
+  const auto frameBudget = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / FPS));
+  uint64_t tracedBefore = 0;
+  auto lastReport = Clock::now();
+
+  refiner.start();
+
   while (running) {
     bool cameraUpdate = false;
-    uint32_t frameStart = SDL_GetTicks();
+    const auto frameStart = Clock::now();
+    uint64_t motionSamples = 0;
+
+    // Grant this frame's budget to refinement
+    refiner.beginFrame();
 
     while (SDL_PollEvent(&event)) {
       if (event.type == SDL_QUIT) running = false;
@@ -72,7 +118,7 @@ void Renderer::run() {
       }
     }
 
-    // Copy back pixels to front if ready
+    // Copy finished tiles of the back pixels to the texture
     updateImage8();
 
     // Move camera with arrow keys/wasdqe
@@ -126,39 +172,49 @@ void Renderer::run() {
       Scene& sc = scene;
       sc.moveCameraPosition(dir.norm().scale(moveSpeed));
 
-      // Clear all tasks in the tracer pool
-      tracer.pool.clearTasks();
-
-      // Reset backPixel buffer and tileReady flags
-      std::fill(backPixels.pxColors.begin(), backPixels.pxColors.end(),
-                Color());
-      std::fill(backPixels.pxSamples.begin(), backPixels.pxSamples.end(), 0);
-      for (int y = 0; y < h; ++y) {
-        backPixels.rowReady[y].store(false, std::memory_order_release);
+      if (!moving) {
+        // Drop full-resolution refinement: running tiles notice between rows
+        // and bail out, so stopping waits for little. What was refined so far
+        // is kept for the view the camera stops at
+        const uint64_t shown = backPixels.currentGeneration();
+        backPixels.invalidate();
+        refiner.stop();
+        reprojector.capture(backPixels, refiner.view(), shown, tracer.pool);
+        moving = true;
       }
+      stillFrames = 0;
+      motionSamples = renderMotionFrame();
+    } else if (moving && ++stillFrames >= STILL_FRAMES) {
+      // Camera stopped: refine the last view at full resolution, starting from
+      // the reprojected samples. Tiles replace the upsampled frame as they
+      // finish
+      moving = false;
+      backPixels.invalidate();
+      reprojector.apply(backPixels, tracer.rayGenerator(), tracer.pool);
+      refiner.start();
     }
 
-    // Make sure tracer isn't overloaded with tasks
-    if (tracer.pool.numTasks() <= scene.getHeight()) {
-      tracer.refinePixels(backPixels);
-    }
-
-    SDL_UpdateTexture(texture, nullptr, image8.data(), w * 3);
     SDL_RenderClear(sdlRenderer);
     SDL_RenderCopy(sdlRenderer, texture, nullptr, nullptr);
     SDL_RenderPresent(sdlRenderer);
 
-    const int frameTime = SDL_GetTicks() - frameStart;
-    const int fps = (frameTime > 0) ? (1000 / frameTime) : 0;
+    // Wait out the frame while the workers spend its budget
+    std::this_thread::sleep_until(frameStart + frameBudget);
 
-    if (fps > FPS) {
-      SDL_Delay(1000 / FPS - frameTime);
+    const uint64_t traced = refiner.samplesTraced();
+    frameMetrics.addFrame(Clock::now() - frameStart,
+                          traced - tracedBefore + motionSamples);
+    tracedBefore = traced;
+    if (statsOut && Clock::now() - lastReport >= statsPeriod) {
+      printFrameStats(*statsOut, frameMetrics.stats());
+      lastReport = Clock::now();
     }
-    // frameTime = SDL_GetTicks() - frameStart;
-    // fps = (frameTime > 0) ? (1000 / frameTime) : 0;
-    // std::cout << "FPS: " << fps << std::endl;
   }
 
+  // Let running passes bail out before the pixels go away
+  backPixels.invalidate();
+  refiner.stop();
+
   SDL_DestroyTexture(texture);
   SDL_DestroyRenderer(sdlRenderer);
   SDL_DestroyWindow(window);
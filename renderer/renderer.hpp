@@ -1,5 +1,13 @@
 #pragma once
+#include <chrono>
+#include <memory>
+#include <ostream>
+
 #include "SDL.h"
+#include "renderer/refiner.hpp"
+#include "renderer/reprojection.hpp"
+#include "renderer/resolution.hpp"
+#include "renderer/telemetry.hpp"
 #include "renderer/tracer.hpp"
 #include "scene/scene.hpp"
 
@@ -12,24 +20,68 @@ class Renderer {
   Pixels backPixels;
   std::vector<uint8_t> image8;  // Raw image data for SDL
   Tracer tracer;
+  Refiner refiner;  // Feeds tiles to the pool as workers free up
   const int FPS;
+  // While the camera moves, frames are traced at a reduced resolution
+  ResolutionScaler scaler;
+  std::vector<std::unique_ptr<Pixels>> motionPixels;  // Per downscale factor
+  bool moving = false;
+  int stillFrames = 0;  // Frames since the camera last moved
+  // Carries the refined image over the motion into the view where it stops
+  Reprojector reprojector;
+  FrameMetrics frameMetrics;
+  ToneMapping toneMapping;  // Applied to the display and saved images
+  std::ostream* statsOut = nullptr;  // Where to report frame stats, if any
+  std::chrono::milliseconds statsPeriod{0};
   SDL_Window* window = nullptr;
   SDL_Renderer* sdlRenderer = nullptr;
   SDL_Texture* texture = nullptr;
   static constexpr double MOVE_SPEED = 0.5;
+  // Pixels stop refining once their mean is within a quarter 8-bit step
+  static constexpr double ADAPTIVE_ERROR = 0.25 / 255.0;
+  // Still frames before refining at full resolution again (mouse drags
+  // report no motion on some frames)
+  static constexpr int STILL_FRAMES = 3;
 
   void updateImage8();
+  uint64_t renderMotionFrame();
 
  public:
-  Renderer(Scene sc, int fps = 60)
+  // Renders on the shared pool unless given one (e.g. with pinned workers)
+  Renderer(Scene sc, int fps = 60, ThreadPool& pool = ThreadPool::shared())
       : scene(sc),
         backPixels(sc.getWidth(), sc.getHeight()),
         image8(sc.getWidth() * sc.getHeight() * 3, 0),
-        tracer(scene),
-        FPS(fps) {}
+        tracer(scene, pool),
+        refiner(tracer, backPixels),
+        FPS(fps),
+        scaler(1.0 / fps),
+        motionPixels(ResolutionScaler::MAX_FACTOR + 1),
+        reprojector(sc.getWidth(), sc.getHeight()) {
+    tracer.setAdaptiveSampling(ADAPTIVE_ERROR);
+    backPixels.enableFrames();
+    tracer.prefault(backPixels);
+    // Queue only the refinement that fits in a frame, so pacing holds up
+    refiner.setFrameBudget(std::chrono::duration<double>(1.0 / fps));
+  }
 
   void run();
 
+  // Print frame time percentiles and samples/s every period while running
+  void reportFrameStats(
+      std::ostream& out,
+      std::chrono::milliseconds every = std::chrono::seconds(5)) {
+    statsOut = &out;
+    statsPeriod = every;
+  }
+  FrameStats frameStats() const { return frameMetrics.stats(); }
+
+  // Exposure and transfer curve of the displayed image; set before run()
+  void setToneMapping(const ToneMapping& mapping) {
+    toneMapping = mapping;
+    backPixels.resolver = Resolver(mapping);
+  }
+
   ~Renderer() = default;
 
   friend class Image;
@@ -0,0 +1,167 @@
+#include "reprojection.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+Reprojector::Reprojector(int w, int h)
+    : width(w), height(h), history(w * h), target(w * h), targetDepth(w * h) {}
+
+// Keep the pixels accumulated for generation gen, seen through rays
+// The pixels must not be rendered to meanwhile
+void Reprojector::capture(const Pixels& pixels, const RayGenerator& rays,
+                          uint64_t gen, ThreadPool& pool) {
+  view = rays;
+  pool.parallelFor(
+      0, pixels.numTiles(), 1,
+      [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) {
+          const Tile& tile = pixels.tiles[t];
+          const bool current = pixels.tileGeneration[t] == gen;
+          for (int y = tile.y0; y < tile.y1; ++y) {
+            for (int x = tile.x0; x < tile.x1; ++x) {
+              const int i = y * width + x;
+              const int n = current ? pixels.pxSamples[i] : 0;
+              History& h = history[i];
+              h.samples = n;
+              if (n == 0) continue;
+              h.mean = pixels.pxColors[i] / static_cast<double>(n);
+              h.variance = n > 1 ? pixels.pxLumaM2[i] / (n - 1) : 0.0f;
+              h.depth = pixels.pxDepth[i];
+              h.normal = pixels.pxNormal[i];
+              if (h.depth >= 0.0f) {
+                const Ray ray = rays.ray(x + 0.5, y + 0.5);
+                h.pos = ray.orig + ray.dir * h.depth;
+              }
+            }
+          }
+        }
+      },
+      Priority::Interactive);
+}
+
+// Pixel (x, y) of the captured view straddles two surfaces: a neighbour is
+// off its tangent plane, or only one of them is background
+bool Reprojector::depthEdge(int x, int y) const {
+  const History& h = history[y * width + x];
+  const int nx[] = {x - 1, x + 1, x, x};
+  const int ny[] = {y, y, y - 1, y + 1};
+  for (int k = 0; k < 4; ++k) {
+    if (nx[k] < 0 || nx[k] >= width || ny[k] < 0 || ny[k] >= height) continue;
+    const History& n = history[ny[k] * width + nx[k]];
+    if (n.samples == 0) continue;
+    if ((h.depth < 0.0f) != (n.depth < 0.0f)) return true;
+    if (h.depth >= 0.0f &&
+        std::abs(h.normal * (n.pos - h.pos)) > PLANE_TOLERANCE * h.depth) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// New pixel (x, y) lies behind the surface landing next to it, as seen from
+// eye: it most likely shows through a gap between that surface's samples
+bool Reprojector::occluded(int x, int y, const Vector& eye) const {
+  const History& h = history[target[y * width + x]];
+  for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1); ++ny) {
+    for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); ++nx) {
+      const int r = target[ny * width + nx];
+      if (r < 0) continue;
+      const History& n = history[r];
+      if (n.depth < 0.0f) continue;  // Nothing is behind background
+      if (h.depth < 0.0f) return true;
+
+      // Distance in front of the neighbour's plane, positive toward the eye
+      const double side = n.normal * (eye - n.pos) < 0.0 ? -1.0 : 1.0;
+      const double front = side * (n.normal * (h.pos - n.pos));
+      if (front < -PLANE_TOLERANCE * n.depth) return true;
+    }
+  }
+  return false;
+}
+
+// Seed pixels, freshly invalidated for the view of rays, with the captured
+// history and return the number of pixels seeded
+// The pixels must not be rendered to meanwhile. History is used once
+int Reprojector::apply(Pixels& pixels, const RayGenerator& rays,
+                       ThreadPool& pool) {
+  if (!view) return 0;
+  // Background sorts behind every surface
+  const float far = std::numeric_limits<float>::max();
+  std::fill(target.begin(), target.end(), -1);
+  std::fill(targetDepth.begin(), targetDepth.end(), far);
+
+  // Move each history pixel's surface into the new view, nearest wins
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int p = y * width + x;
+      const History& h = history[p];
+      if (h.samples == 0 || depthEdge(x, y)) continue;
+
+      // Background stays in its direction
+      Vector dir = view->ray(x + 0.5, y + 0.5).dir;
+      float depth = far;
+      if (h.depth >= 0.0f) {
+        const Vector seen = h.pos - view->getOrigin();
+        dir = h.pos - rays.getOrigin();
+        depth = dir.mag();
+        // Seen from the other side now: it was the back of something
+        if ((h.normal * seen < 0.0) != (h.normal * dir < 0.0)) continue;
+      }
+
+      const std::optional<ImagePoint> point = rays.projectDir(dir);
+      if (!point) continue;
+      const int i = static_cast<int>(std::floor(point->i));
+      const int j = static_cast<int>(std::floor(point->j));
+      if (i < 0 || i >= width || j < 0 || j >= height) continue;
+      const int q = j * width + i;
+      if (target[q] < 0 || depth < targetDepth[q]) {
+        target[q] = p;
+        targetDepth[q] = depth;
+      }
+    }
+  }
+
+  // Reset every tile for the new generation and seed the pixels that kept
+  // their history; tiles are marked ready so the display shows them at once
+  const uint64_t gen = pixels.currentGeneration();
+  const int seeded = pool.parallelReduce(
+      0, pixels.numTiles(), 1, 0,
+      [&](int begin, int end) {
+        int count = 0;
+        for (int t = begin; t < end; ++t) {
+          const Tile& tile = pixels.tiles[t];
+          std::unique_lock<std::mutex> lock(pixels.tileLocks[t]);
+          for (int y = tile.y0; y < tile.y1; ++y) {
+            for (int x = tile.x0; x < tile.x1; ++x) {
+              const int q = y * width + x;
+              pixels.pxColors[q] = Color();
+              pixels.pxSamples[q] = 0;
+              pixels.pxLumaMean[q] = 0.0f;
+              pixels.pxLumaM2[q] = 0.0f;
+              if (target[q] < 0 || occluded(x, y, rays.getOrigin())) {
+                continue;
+              }
+
+              const History& h = history[target[q]];
+              const int n = std::min(h.samples, HISTORY_SAMPLES);
+              pixels.pxColors[q] = h.mean * static_cast<double>(n);
+              pixels.pxSamples[q] = n;
+              pixels.pxLumaMean[q] = h.mean.luminance();
+              pixels.pxLumaM2[q] = h.variance * (n - 1);
+              pixels.pxDepth[q] = h.depth < 0.0f ? h.depth : targetDepth[q];
+              pixels.pxNormal[q] = h.normal;
+              count++;
+            }
+          }
+          pixels.tileGeneration[t] = gen;
+          pixels.publishTile(t, gen);
+        }
+        return count;
+      },
+      [](int a, int b) { return a + b; }, Priority::Interactive);
+
+  view.reset();
+  return seeded;
+}
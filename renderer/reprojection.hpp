@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "math/color.hpp"
+#include "math/raygen.hpp"
+#include "math/vector.hpp"
+#include "renderer/pool.hpp"
+#include "renderer/tracer.hpp"
+
+// Carries accumulated samples over to a new camera view
+// capture() keeps each pixel's mean color, variance and first-hit surface.
+// apply() moves every kept pixel to where its surface lands in the new view
+// (nearest surface wins) and seeds the pixels there with a few samples' worth
+// of that history. Surfaces that were hidden or at a depth edge, and pixels
+// nothing lands on, start from zero samples as usual. Reflections and
+// highlights depend on the view, so history only counts for a few samples
+class Reprojector {
+ private:
+  static constexpr int HISTORY_SAMPLES = 2;  // Max weight of history
+  // Distance off a pixel's tangent plane, relative to its depth, at which
+  // another point counts as a different surface
+  static constexpr double PLANE_TOLERANCE = 0.05;
+
+  struct History {
+    Color mean;
+    float variance = 0.0f;  // Of the luminance samples
+    float depth = 0.0f;     // Negative for background
+    Vector pos;             // World position of the surface
+    Vector normal;
+    int samples = 0;        // 0 when the pixel has no history
+  };
+
+  const int width, height;
+  std::vector<History> history;      // Per pixel of the captured view
+  std::optional<RayGenerator> view;  // Captured view, empty when none
+  std::vector<int> target;           // History pixel landing on each pixel
+  std::vector<float> targetDepth;    // Its distance from the new view
+
+  bool depthEdge(int x, int y) const;
+  bool occluded(int x, int y, const Vector& eye) const;
+
+ public:
+  Reprojector(int w, int h);
+
+  void capture(const Pixels& pixels, const RayGenerator& rays, uint64_t gen,
+               ThreadPool& pool);
+  int apply(Pixels& pixels, const RayGenerator& rays, ThreadPool& pool);
+};
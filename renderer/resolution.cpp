@@ -0,0 +1,63 @@
+#include "resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionScaler::ResolutionScaler(double frameSeconds, int limit)
+    : budget(frameSeconds),
+      maxFactor(std::max(limit, 1)),
+      current(std::min(2, maxFactor)) {}
+
+// Record the time of a frame traced at the current factor
+void ResolutionScaler::update(double seconds) {
+  const double cost = seconds * current * current;
+  fullCost = fullCost > 0.0 ? fullCost + SMOOTHING * (cost - fullCost) : cost;
+
+  const double ideal = std::sqrt(fullCost / (budget * HEADROOM));
+  current = std::clamp(static_cast<int>(std::ceil(ideal)), 1, maxFactor);
+}
+
+// Colors are interpolated in linear space and resolved with low's resolver
+void upsample(const Pixels& low, int factor, int width, int height,
+              std::vector<uint8_t>& image8, ThreadPool& pool,
+              Priority priority) {
+  const int lw = low.width;
+  const int lh = low.height;
+  auto average = [&](int x, int y) {
+    const int i = y * lw + x;
+    const int n = low.pxSamples[i];
+    return n > 0 ? low.pxColors[i] / static_cast<double>(n) : Color();
+  };
+
+  pool.parallelFor(
+      0, height, 8,
+      [&](int begin, int end) {
+        thread_local std::vector<Color> row;
+        row.resize(width);
+        for (int y = begin; y < end; ++y) {
+          // Low-res pixel centers sit at (i + 0.5) * factor
+          const double v =
+              std::clamp((y + 0.5) / factor - 0.5, 0.0, lh - 1.0);
+          const int y0 = static_cast<int>(v);
+          const int y1 = std::min(y0 + 1, lh - 1);
+          const double fy = v - y0;
+
+          for (int x = 0; x < width; ++x) {
+            const double u =
+                std::clamp((x + 0.5) / factor - 0.5, 0.0, lw - 1.0);
+            const int x0 = static_cast<int>(u);
+            const int x1 = std::min(x0 + 1, lw - 1);
+            const double fx = u - x0;
+
+            const Color top =
+                average(x0, y0) * (1.0 - fx) + average(x1, y0) * fx;
+            const Color bottom =
+                average(x0, y1) * (1.0 - fx) + average(x1, y1) * fx;
+            row[x] = top * (1.0 - fy) + bottom * fy;
+          }
+          low.resolver.resolveRow(row.data(), nullptr, width,
+                                  &image8[y * width * 3], 3);
+        }
+      },
+      priority);
+}
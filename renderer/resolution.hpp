@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "renderer/pool.hpp"
+#include "renderer/tracer.hpp"
+
+// Picks the downscale factor of frames traced while the camera moves
+// Tracing cost follows the pixel count, so a frame taking t seconds at factor
+// f predicts t * f^2 at full size. That estimate is smoothed over frames and
+// the factor set to the smallest one expected to fit within the frame budget
+class ResolutionScaler {
+ private:
+  static constexpr double HEADROOM = 0.8;   // Share of the budget to aim for
+  static constexpr double SMOOTHING = 0.5;  // Weight of the latest frame
+
+  const double budget;    // Seconds per frame
+  const int maxFactor;
+  double fullCost = 0.0;  // Smoothed seconds per full-size frame, 0 unknown
+  int current;            // Factor of the next motion frame
+
+ public:
+  static constexpr int MAX_FACTOR = 4;
+
+  ResolutionScaler(double frameSeconds, int maxFactor = MAX_FACTOR);
+
+  int factor() const { return current; }
+  void update(double seconds);
+};
+
+// Bilinearly upsample pixels traced at 1/factor of width x height to 8-bit RGB
+void upsample(const Pixels& low, int factor, int width, int height,
+              std::vector<uint8_t>& image8, ThreadPool& pool,
+              Priority priority = Priority::Interactive);
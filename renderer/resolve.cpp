@@ -0,0 +1,61 @@
+#include "resolve.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+Resolver::Resolver(const ToneMapping& mapping)
+    : exposure(mapping.exposure),
+      linear(mapping.curve == ToneCurve::Linear) {
+  for (int k = 0; k <= LUT_SIZE; ++k) {
+    const double v = static_cast<double>(k) / LUT_SIZE;
+    double out = v;
+    if (mapping.curve == ToneCurve::Gamma) {
+      out = std::pow(v, 1.0 / mapping.gamma);
+    } else if (mapping.curve == ToneCurve::SRGB) {
+      out = v <= 0.0031308 ? 12.92 * v : 1.055 * std::pow(v, 1.0 / 2.4) - 0.055;
+    }
+    lut[k] = static_cast<uint8_t>(std::round(std::clamp(out, 0.0, 1.0) * 255));
+  }
+}
+
+// Works in blocks: scale and quantize every channel into a small array, then
+// pack (through the table for curves). Each loop is branch-free
+void Resolver::resolveRow(const Color* colors, const int* samples, int count,
+                          uint8_t* out, int channels) const {
+  constexpr int BLOCK = 64;
+  double scale[BLOCK];
+  int quant[BLOCK * 3];
+  const double steps = linear ? 255.0 : LUT_SIZE;
+
+  for (int first = 0; first < count; first += BLOCK) {
+    const int size = std::min(BLOCK, count - first);
+    const Color* in = colors + first;
+
+    // Same reciprocal as Color's division, so linear output is bit-identical
+    for (int k = 0; k < size; ++k) {
+      const int n = samples ? samples[first + k] : 1;
+      scale[k] = exposure * (1.0 / (n > 0 ? n : 1));
+    }
+    for (int k = 0; k < size; ++k) {
+      const double rgb[3] = {in[k].r(), in[k].g(), in[k].b()};
+      for (int c = 0; c < 3; ++c) {
+        const double v = std::min(std::max(rgb[c] * scale[k], 0.0), 1.0);
+        quant[k * 3 + c] = static_cast<int>(v * steps + 0.5);
+      }
+    }
+
+    uint8_t* px = out + first * channels;
+    for (int k = 0; k < size; ++k, px += channels) {
+      for (int c = 0; c < 3; ++c) {
+        const int q = quant[k * 3 + c];
+        px[c] = linear ? static_cast<uint8_t>(q) : lut[q];
+      }
+    }
+    if (channels == 4) {
+      px = out + first * 4;
+      for (int k = 0; k < size; ++k) {
+        px[k * 4 + 3] = (samples ? samples[first + k] : 1) > 0 ? 255 : 0;
+      }
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "math/color.hpp"
+
+// Transfer curve applied to linear colors before quantizing
+enum class ToneCurve { Linear, Gamma, SRGB };
+
+struct ToneMapping {
+  double exposure = 1.0;  // Scale applied before the curve
+  ToneCurve curve = ToneCurve::Linear;
+  double gamma = 2.2;  // For ToneCurve::Gamma
+};
+
+// Turns accumulated colors into 8-bit pixels
+// Rows are resolved in blocks by short branch-free loops, so the compiler
+// vectorizes the divide, clamp and quantize steps. Linear output is quantized
+// directly and matches Color::getBytes; other curves go through a lookup
+// table over [0, 1].
+class Resolver {
+ private:
+  static constexpr int LUT_SIZE = 1 << 14;  // Curve steps
+
+  double exposure;
+  bool linear;
+  std::array<uint8_t, LUT_SIZE + 1> lut;
+
+ public:
+  explicit Resolver(const ToneMapping& mapping = {});
+
+  // Pack count pixels of colors summed over samples (averaged already if
+  // samples is null) as RGB8 (channels 3) or RGBA8 (channels 4)
+  // RGBA alpha is 0 for pixels without samples, 255 otherwise
+  void resolveRow(const Color* colors, const int* samples, int count,
+                  uint8_t* out, int channels) const;
+};
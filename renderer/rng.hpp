@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Counter-based random numbers (Philox4x32-10, Salmon et al. 2011)
+// Stateless: the same counter and key always give the same four numbers, so
+// any thread can draw any sample's numbers in any order
+inline std::array<uint32_t, 4> philox(std::array<uint32_t, 4> ctr,
+                                      std::array<uint32_t, 2> key) {
+  constexpr uint64_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+  constexpr uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+  for (int round = 0; round < 10; ++round) {
+    const uint64_t p0 = M0 * ctr[0];
+    const uint64_t p1 = M1 * ctr[2];
+    ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+           static_cast<uint32_t>(p1),
+           static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+           static_cast<uint32_t>(p0)};
+    key[0] += W0;
+    key[1] += W1;
+  }
+  return ctr;
+}
+
+// Random numbers of one pixel sample, one per dimension (jitter x, jitter y,
+// scramble seeds, ...), keyed by pixel, sample index and seed
+class SampleRng {
+ private:
+  static constexpr uint32_t PIXEL_INDEX = 0xffffffffu;  // Per-pixel stream
+
+  const uint32_t px, py, index, seed;
+
+ public:
+  SampleRng(int x, int y, uint32_t i, uint32_t s = 0)
+      : px(x), py(y), index(i), seed(s) {}
+
+  // Numbers shared by all samples of a pixel
+  static SampleRng pixel(int x, int y, uint32_t s = 0) {
+    return SampleRng(x, y, PIXEL_INDEX, s);
+  }
+
+  // 32 random bits for a dimension
+  uint32_t bits(uint32_t dim) const {
+    return philox({px, py, index, dim / 4}, {seed, 0x5eedu})[dim % 4];
+  }
+
+  // Uniform in [0, 1) for a dimension
+  double uniform(uint32_t dim) const { return (bits(dim) >> 8) * 0x1p-24; }
+};
@@ -0,0 +1,104 @@
+#include "sampler.hpp"
+
+#include <cmath>
+
+#include "renderer/rng.hpp"
+
+// Map the top 24 bits to [0, 1)
+static inline double toUnit(uint32_t x) { return (x >> 8) * 0x1p-24; }
+
+static inline double fract(double x) { return x - std::floor(x); }
+
+// ----- Owen scrambling -----
+
+static inline uint32_t reverseBits(uint32_t x) {
+  x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+  x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+  x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+  return (x >> 16) | (x << 16);
+}
+
+// Hash in which every bit depends only on the bits below it (Laine-Karras)
+static inline uint32_t laineKarras(uint32_t x, uint32_t seed) {
+  x += seed;
+  x ^= x * 0x6c50b47cu;
+  x ^= x * 0xb82f1e52u;
+  x ^= x * 0xc7afe638u;
+  x ^= x * 0x8d22f6e6u;
+  return x;
+}
+
+// Nested uniform scramble: each bit flips depending on the bits above it
+// (Burley 2020, "Practical Hash-based Owen Scrambling")
+static inline uint32_t owenScramble(uint32_t x, uint32_t seed) {
+  return reverseBits(laineKarras(reverseBits(x), seed));
+}
+
+// First two Sobol dimensions (van der Corput and its companion)
+static inline uint32_t sobol0(uint32_t i) { return reverseBits(i); }
+static inline uint32_t sobol1(uint32_t i) {
+  uint32_t r = 0;
+  for (uint32_t v = 1u << 31; i; i >>= 1, v ^= v >> 1) {
+    if (i & 1) r ^= v;
+  }
+  return r;
+}
+
+// ----- Samplers -----
+
+std::unique_ptr<Sampler> makeSampler(SamplerType type, uint32_t seed) {
+  switch (type) {
+    case SamplerType::Stratified:
+      return std::make_unique<StratifiedSampler>(seed);
+    case SamplerType::R2:
+      return std::make_unique<R2Sampler>(seed);
+    case SamplerType::BlueNoise:
+      return std::make_unique<BlueNoiseSampler>(seed);
+    case SamplerType::Sobol:
+    default:
+      return std::make_unique<SobolSampler>(seed);
+  }
+}
+
+// Cycle through the cells of a 2x2 grid, jittered within each cell
+SamplePoint StratifiedSampler::get(int px, int py, uint32_t index) const {
+  if (index == 0) return {0.0, 0.0};
+  const int a = GRID_SIZE;
+  const double xCell = (index % a + 0.5) / a;
+  const double yCell = ((index / a) % a + 0.5) / a;
+  const SampleRng rng(px, py, index, seed);
+  return {xCell + (rng.uniform(0) - 0.5) / a,
+          yCell + (rng.uniform(1) - 0.5) / a};
+}
+
+// Shuffle the sequence per pixel, then scramble each dimension
+// Any power-of-two prefix still has one sample per stratum
+SamplePoint SobolSampler::get(int px, int py, uint32_t index) const {
+  const SampleRng rng = SampleRng::pixel(px, py, seed);
+  const uint32_t i = owenScramble(index, rng.bits(0));
+  return {toUnit(owenScramble(sobol0(i), rng.bits(1))),
+          toUnit(owenScramble(sobol1(i), rng.bits(2)))};
+}
+
+// Generalized golden ratio for two dimensions (plastic number)
+static constexpr double R2_G = 1.32471795724474602596;
+static constexpr double R2_A1 = 1.0 / R2_G;
+static constexpr double R2_A2 = 1.0 / (R2_G * R2_G);
+
+// Sequence shifted by a per-pixel random offset (Cranley-Patterson)
+SamplePoint R2Sampler::get(int px, int py, uint32_t index) const {
+  const SampleRng rng = SampleRng::pixel(px, py, seed);
+  return {fract(rng.uniform(0) + R2_A1 * index),
+          fract(rng.uniform(1) + R2_A2 * index)};
+}
+
+// Same sequence, but offset by the R2 dither mask of the pixel position:
+// neighbours get far-apart offsets, which pushes the remaining error to high
+// frequencies (blue noise) without a precomputed noise texture
+SamplePoint BlueNoiseSampler::get(int px, int py, uint32_t index) const {
+  const double shift = SampleRng::pixel(0, 0, seed).uniform(0);
+  const double mask = fract(R2_A1 * px + R2_A2 * py + shift);
+  return {fract(mask + R2_A1 * index),
+          fract(fract(mask * R2_G) + R2_A2 * index)};
+}
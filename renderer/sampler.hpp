@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+// Position of a sample within its pixel, each coordinate in [0, 1)
+struct SamplePoint {
+  double x, y;
+};
+
+// Anti-aliasing sample positions, indexed by pixel and sample number
+// Random numbers come from the counter-based SampleRng (no shared state), so
+// a pixel's samples are the same whichever thread draws them and in whatever
+// order: renders are bit-identical for any thread count and tile order
+class Sampler {
+ public:
+  virtual ~Sampler() = default;
+  virtual SamplePoint get(int px, int py, uint32_t index) const = 0;
+};
+
+// Stratified: the original 2x2 grid with jitter (first sample at the corner)
+// Sobol: Owen-scrambled Sobol (0,2)-sequence, decorrelated per pixel
+// R2: Roberts' R2 sequence, rotated per pixel
+// BlueNoise: R2 sequence offset by a screen-space blue-noise mask
+enum class SamplerType { Stratified, Sobol, R2, BlueNoise };
+
+std::unique_ptr<Sampler> makeSampler(SamplerType type, uint32_t seed = 0);
+
+class StratifiedSampler final : public Sampler {
+ private:
+  static constexpr int GRID_SIZE = 2;
+  const uint32_t seed;
+
+ public:
+  explicit StratifiedSampler(uint32_t s = 0) : seed(s) {}
+  SamplePoint get(int px, int py, uint32_t index) const override;
+};
+
+class SobolSampler final : public Sampler {
+ private:
+  const uint32_t seed;
+
+ public:
+  explicit SobolSampler(uint32_t s = 0) : seed(s) {}
+  SamplePoint get(int px, int py, uint32_t index) const override;
+};
+
+class R2Sampler final : public Sampler {
+ private:
+  const uint32_t seed;
+
+ public:
+  explicit R2Sampler(uint32_t s = 0) : seed(s) {}
+  SamplePoint get(int px, int py, uint32_t index) const override;
+};
+
+class BlueNoiseSampler final : public Sampler {
+ private:
+  const uint32_t seed;
+
+ public:
+  explicit BlueNoiseSampler(uint32_t s = 0) : seed(s) {}
+  SamplePoint get(int px, int py, uint32_t index) const override;
+};
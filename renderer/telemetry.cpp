@@ -0,0 +1,151 @@
+#include "telemetry.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+#include "renderer/pool.hpp"
+
+WorkerStats& WorkerStats::operator+=(const WorkerStats& other) {
+  tasks += other.tasks;
+  steals += other.steals;
+  injected += other.injected;
+  spinHits += other.spinHits;
+  parks += other.parks;
+  busyNanos += other.busyNanos;
+  spinNanos += other.spinNanos;
+  parkedNanos += other.parkedNanos;
+  lockWaitNanos += other.lockWaitNanos;
+  return *this;
+}
+
+// Sum over all workers
+WorkerStats PoolStats::total() const {
+  WorkerStats sum;
+  for (const WorkerStats& worker : workers) sum += worker;
+  return sum;
+}
+
+static double millis(uint64_t nanos) { return nanos / 1e6; }
+
+// One line per worker plus the pool-wide counters
+void printStats(std::ostream& out, const PoolStats& stats) {
+  const std::ios::fmtflags flags = out.flags();
+  out << std::fixed << std::setprecision(1);
+  out << "pool: queued " << stats.queued << " (" << stats.laneQueued[0] << "/"
+      << stats.laneQueued[1] << "/" << stats.laneQueued[2]
+      << "), submit lock wait " << millis(stats.submitLockWaitNanos)
+      << " ms\n";
+  for (size_t i = 0; i < stats.workers.size(); ++i) {
+    const WorkerStats& w = stats.workers[i];
+    out << "  worker " << std::setw(2) << i << ": " << std::setw(8)
+        << w.tasks << " tasks, " << std::setw(6) << w.steals << " steals, "
+        << std::setw(6) << w.injected << " injected, busy "
+        << millis(w.busyNanos) << " ms, spin " << millis(w.spinNanos)
+        << " ms (" << w.spinHits << " hits), parked "
+        << millis(w.parkedNanos) << " ms (" << w.parks << "x), lock wait "
+        << millis(w.lockWaitNanos) << " ms\n";
+  }
+  out.flags(flags);
+}
+
+void printStatsCsvHeader(std::ostream& out) {
+  out << "elapsed_ms,worker,queued,tasks,steals,injected,spin_hits,parks,"
+         "busy_ms,spin_ms,parked_ms,lock_wait_ms\n";
+}
+
+// One row per worker
+void printStatsCsv(std::ostream& out, const PoolStats& stats,
+                   std::chrono::milliseconds elapsed) {
+  for (size_t i = 0; i < stats.workers.size(); ++i) {
+    const WorkerStats& w = stats.workers[i];
+    out << elapsed.count() << "," << i << "," << stats.queued << ","
+        << w.tasks << "," << w.steals << "," << w.injected << ","
+        << w.spinHits << "," << w.parks << "," << millis(w.busyNanos) << ","
+        << millis(w.spinNanos) << "," << millis(w.parkedNanos) << ","
+        << millis(w.lockWaitNanos) << "\n";
+  }
+}
+
+// ----- FrameMetrics -----
+
+void FrameMetrics::addFrame(std::chrono::duration<double> time,
+                            uint64_t traced) {
+  if (seconds.size() < WINDOW) {
+    seconds.push_back(time.count());
+    samples.push_back(traced);
+    return;
+  }
+  seconds[next] = time.count();
+  samples[next] = traced;
+  next = (next + 1) % WINDOW;
+}
+
+FrameStats FrameMetrics::stats() const {
+  FrameStats stats;
+  stats.frames = seconds.size();
+  if (seconds.empty()) return stats;
+
+  std::vector<double> sorted = seconds;
+  std::sort(sorted.begin(), sorted.end());
+  auto percentile = [&](double p) {
+    const size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::max<size_t>(rank, 1) - 1] * 1e3;
+  };
+  stats.p50 = percentile(0.50);
+  stats.p90 = percentile(0.90);
+  stats.p99 = percentile(0.99);
+  stats.worst = sorted.back() * 1e3;
+
+  const double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+  const uint64_t traced =
+      std::accumulate(samples.begin(), samples.end(), uint64_t{0});
+  stats.samplesPerSecond = total > 0.0 ? traced / total : 0.0;
+  return stats;
+}
+
+void printFrameStats(std::ostream& out, const FrameStats& stats) {
+  const std::ios::fmtflags flags = out.flags();
+  out << std::fixed << std::setprecision(1);
+  out << "frames: " << stats.frames << ", frame time p50 " << stats.p50
+      << " ms, p90 " << stats.p90 << " ms, p99 " << stats.p99
+      << " ms, worst " << stats.worst << " ms, "
+      << stats.samplesPerSecond / 1e6 << " Msamples/s\n";
+  out.flags(flags);
+}
+
+// ----- StatsDumper -----
+
+StatsDumper::StatsDumper(ThreadPool& p, std::ostream& os,
+                         std::chrono::milliseconds every, bool asCsv)
+    : pool(p), out(os), period(every), csv(asCsv) {
+  thread = std::thread([this] { run(); });
+}
+
+void StatsDumper::run() {
+  const auto start = std::chrono::steady_clock::now();
+  if (csv) printStatsCsvHeader(out);
+
+  std::unique_lock<std::mutex> lock(mtx);
+  while (!cvStop.wait_for(lock, period, [this] { return stop; })) {
+    const PoolStats stats = pool.stats();
+    if (csv) {
+      printStatsCsv(out, stats,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start));
+    } else {
+      printStats(out, stats);
+    }
+    out.flush();
+  }
+}
+
+StatsDumper::~StatsDumper() {
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    stop = true;
+  }
+  cvStop.notify_all();
+  thread.join();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Forward declaration
+class ThreadPool;
+
+// Counters of one pool worker, copied out by ThreadPool::stats()
+// Times are in nanoseconds and, like the counts, cumulative
+struct WorkerStats {
+  uint64_t tasks = 0;          // Tasks run (nested ones included)
+  uint64_t steals = 0;         // Tasks stolen from other workers
+  uint64_t injected = 0;       // Tasks taken from the injection queue
+  uint64_t spinHits = 0;       // Spins that found a task before parking
+  uint64_t parks = 0;          // Times parked
+  uint64_t busyNanos = 0;      // Running tasks
+  uint64_t spinNanos = 0;      // Spinning for work
+  uint64_t parkedNanos = 0;    // Parked
+  uint64_t lockWaitNanos = 0;  // Waiting for the injection queue lock
+
+  WorkerStats& operator+=(const WorkerStats& other);
+};
+
+// Snapshot of a pool's scheduler counters
+struct PoolStats {
+  std::vector<WorkerStats> workers;
+  int queued = 0;                     // Tasks not yet started
+  int laneQueued[3] = {};             // Per Priority lane
+  uint64_t submitLockWaitNanos = 0;   // Outside threads waiting for the lock
+
+  WorkerStats total() const;
+};
+
+void printStats(std::ostream& out, const PoolStats& stats);
+void printStatsCsvHeader(std::ostream& out);
+void printStatsCsv(std::ostream& out, const PoolStats& stats,
+                   std::chrono::milliseconds elapsed);
+
+// Frame pacing over the last frames recorded by FrameMetrics
+// Frame times are in milliseconds, percentiles by nearest rank
+struct FrameStats {
+  int frames = 0;
+  double p50 = 0.0;
+  double p90 = 0.0;
+  double p99 = 0.0;
+  double worst = 0.0;
+  double samplesPerSecond = 0.0;  // Samples traced over the frames' time
+};
+
+// Rolling window of frame times and the samples traced in each frame
+// Not thread-safe: record and read from the render loop
+class FrameMetrics {
+ private:
+  static constexpr size_t WINDOW = 240;  // Frames kept
+
+  std::vector<double> seconds;
+  std::vector<uint64_t> samples;
+  size_t next = 0;  // Slot of the next frame once the window is full
+
+ public:
+  void addFrame(std::chrono::duration<double> time, uint64_t traced);
+  FrameStats stats() const;
+};
+
+void printFrameStats(std::ostream& out, const FrameStats& stats);
+
+// Dumps a pool's stats every period from its own thread until destroyed
+// Plain text for a quick look, CSV (one row per worker and dump) for plots
+class StatsDumper {
+ private:
+  ThreadPool& pool;
+  std::ostream& out;
+  const std::chrono::milliseconds period;
+  const bool csv;
+  std::mutex mtx;
+  std::condition_variable cvStop;
+  bool stop = false;
+  std::thread thread;
+
+  void run();
+
+ public:
+  StatsDumper(ThreadPool& p, std::ostream& os,
+              std::chrono::milliseconds every = std::chrono::seconds(1),
+              bool asCsv = false);
+  StatsDumper(const StatsDumper&) = delete;
+  StatsDumper& operator=(const StatsDumper&) = delete;
+
+  ~StatsDumper();
+};
@@ -0,0 +1,65 @@
+#include "tiles.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+// Position of (x, y) along the Hilbert curve filling an n x n grid (n a
+// power of two)
+static int64_t hilbertIndex(int n, int x, int y) {
+  int64_t d = 0;
+  for (int s = n / 2; s > 0; s /= 2) {
+    const int rx = (x & s) > 0;
+    const int ry = (y & s) > 0;
+    d += static_cast<int64_t>(s) * s * ((3 * rx) ^ ry);
+    // Rotate the quadrant so the curve stays continuous
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+std::vector<Tile> makeTiles(int w, int h, int size, TileOrder order) {
+  size = std::max(size, 1);
+  const int cols = (w + size - 1) / size;
+  const int rows = (h + size - 1) / size;
+
+  // Tile grid coordinates with their sort key
+  std::vector<std::pair<double, Tile>> keyed;
+  keyed.reserve(cols * rows);
+  int n = 1;
+  while (n < std::max(cols, rows)) n *= 2;
+  const double cx = (cols - 1) / 2.0, cy = (rows - 1) / 2.0;
+
+  for (int ty = 0; ty < rows; ++ty) {
+    for (int tx = 0; tx < cols; ++tx) {
+      const Tile tile{tx * size, ty * size, std::min((tx + 1) * size, w),
+                      std::min((ty + 1) * size, h)};
+      double key = ty * cols + tx;
+      if (order == TileOrder::Hilbert) {
+        key = hilbertIndex(n, tx, ty);
+      } else if (order == TileOrder::Spiral) {
+        // Ring around the center first, then the angle within the ring
+        const double dx = tx - cx, dy = ty - cy;
+        const double ring = std::max(std::abs(dx), std::abs(dy));
+        const double angle = std::atan2(dy, dx) + M_PI;  // [0, 2 pi]
+        key = std::round(ring * 2.0) * 8.0 + angle;
+      }
+      keyed.push_back({key, tile});
+    }
+  }
+
+  std::stable_sort(
+      keyed.begin(), keyed.end(),
+      [](const auto& a, const auto& b) { return a.first < b.first; });
+  std::vector<Tile> tiles;
+  tiles.reserve(keyed.size());
+  for (const auto& [key, tile] : keyed) tiles.push_back(tile);
+  return tiles;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+// Rectangle of pixels [x0, x1) x [y0, y1), the unit of render work
+struct Tile {
+  int x0, y0, x1, y1;
+
+  int width() const { return x1 - x0; }
+  int height() const { return y1 - y0; }
+};
+
+// Order in which tiles are handed out
+// Hilbert: neighbouring tiles follow each other, good for cache locality
+// Spiral: outwards from the center, where the subject usually is
+// Scanline: row by row
+enum class TileOrder { Hilbert, Spiral, Scanline };
+
+// Cover a w x h image with tiles of at most size x size, in the given order
+std::vector<Tile> makeTiles(int w, int h, int size, TileOrder order);
@@ -10,9 +10,15 @@
 #include "renderer/pool.hpp"
 #include "scene/scene.hpp"
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 // Trace a ray through the scene and return the resulting color
-const Color Tracer::traceRay(const Scene& scene, const Ray& ray,
-                             int depth) const {
+// Stores the surface the ray hits first in first, if given
+const Color Tracer::traceRay(const Scene& scene, const Ray& ray, int depth,
+                             FirstHit* first) const {
   // Iterative implementation: follow reflection bounces using a loop
   Color finalColor{0, 0, 0};
   double throughput = 1.0;
@@ -24,22 +30,20 @@ const Color Tracer::traceRay(const Scene& scene, const Ray& ray,
     std::optional<HitInfo> closestHit;
     double closestT = std::numeric_limits<double>::max();
 
-    // Check non-bounded shapes normally
-    for (const std::unique_ptr<Plane>& shape : scene.planes) {
-      std::optional<HitInfo> hitOpt = shape->intersects(currentRay);
-      if (hitOpt.has_value() && hitOpt->t < closestT) {
-        closestT = hitOpt->t;
-        closestHit.emplace(hitOpt.value());
-      }
+    // Check non-bounded shapes with a single pass over all planes
+    std::optional<HitInfo> planeHit = scene.planes.intersects(currentRay);
+    if (planeHit.has_value()) {
+      closestT = planeHit->t;
+      closestHit.emplace(planeHit.value());
     }
 
     // Check bounded shapes using BVH
-    bvh.traverse(scene.bndedShapes, currentRay, [&](const HitInfo& hitInfo) {
-      if (hitInfo.t < closestT) {
-        closestT = hitInfo.t;
-        closestHit.emplace(hitInfo);
-      }
-    });
+    std::optional<HitInfo> bvhHit = bvh->closestHit(
+        scene.bndedShapes, currentRay, scene.getPrecision());
+    if (bvhHit.has_value() && bvhHit->t < closestT) {
+      closestT = bvhHit->t;
+      closestHit.emplace(bvhHit.value());
+    }
 
     if (!closestHit.has_value()) {
       // No hit: add background scaled by current throughput and finish
@@ -48,6 +52,10 @@ const Color Tracer::traceRay(const Scene& scene, const Ray& ray,
     }
 
     const HitInfo hit = closestHit.value();
+    if (bounce == 0 && first) {
+      first->depth = (hit.pos - ray.orig).mag();
+      first->normal = hit.normal;
+    }
 
     // Compute local color at hit point
     const Color localColor = computeLighting(scene, hit);
@@ -102,17 +110,17 @@ const Color Tracer::computeLighting(const Scene& scene,
     bool inShadow = false;
 
     // Shadow check (cast shadow ray toward light)
-    for (const std::unique_ptr<Plane>& shape : scene.planes) {
+    // Closest plane hit is enough: any blocking plane implies the closest does
+    if (!scene.planes.empty()) {
       const Vector toLight = light.position - i;
       const Ray shadowRay(i, toLight);
-      std::optional<HitInfo> shadowHitOpt = shape->intersects(shadowRay);
+      std::optional<HitInfo> shadowHitOpt = scene.planes.intersects(shadowRay);
 
       if (shadowHitOpt.has_value()) {
         const double distToLightSq = toLight.magSq();
         const double tSq = shadowHitOpt->t * shadowHitOpt->t;
         if (tSq < distToLightSq && shadowHitOpt->t > Vector::EPS) {
           inShadow = true;
-          break;
         }
       }
     }
@@ -120,14 +128,16 @@ const Color Tracer::computeLighting(const Scene& scene,
     if (!inShadow) {
       const Vector toLight = light.position - i;
       const Ray shadowRay(i, toLight);
-      bvh.traverseFirstHit(
-          scene.bndedShapes, shadowRay, [&](const HitInfo& shadowHit) {
+      bvh->traverseFirstHit(
+          scene.bndedShapes, shadowRay,
+          [&](const HitInfo& shadowHit) {
             const double distToLightSq = toLight.magSq();
             const double tSq = shadowHit.t * shadowHit.t;
             if (tSq < distToLightSq && shadowHit.t > Vector::EPS) {
               inShadow = true;
             }
-          });
+          },
+          scene.getPrecision());
     }
 
     const Vector lt = (light.position - i).norm();
@@ -155,43 +165,168 @@ const Color Tracer::computeLighting(const Scene& scene,
   return finalColor;
 }
 
-// Expects preallocated pixels vector
-// Updates pixels in place by adding new rays
-// If simple, performs uniform sampling with 1 ray per pixel
-void Tracer::refinePixels(Pixels& pixels) {
-  const int w = scene.getWidth();
-  const int h = scene.getHeight();
-  const int refl = scene.reflections();
-  const Camera& camera = scene.getCamera();
-
-  for (int row = 0; row < h; ++row) {
-    pool.enqueue([this, &pixels, camera, row, w, h, refl]() {
-      thread_local std::mt19937 rng(std::random_device{}());
-      thread_local std::uniform_real_distribution<double> dist(-0.5, 0.5);
-
-      for (int x = 0; x < w; ++x) {
-        const int i = row * w + x;
-        int oldSamples = pixels.pxSamples[i];
-
-        double xQuad = 0.5, yQuad = 0.5, xOffset = 0.0, yOffset = 0.0;
-        if (oldSamples > 0) {
-          const int a = ANTI_ALIAS_GRID_SIZE;
-          xQuad = ((oldSamples % a + 0.5) / a);
-          yQuad = (((oldSamples / a) % a + 0.5) / a);
-          xOffset = xQuad + dist(rng) / a;
-          yOffset = yQuad + dist(rng) / a;
-        }
+#ifdef __linux__
+// Drop the whole pages in [data, data + bytes): they read back as zeros and
+// are faulted in again by the thread that touches them first
+static void releasePages(void* data, size_t bytes) {
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+  const uintptr_t addr = reinterpret_cast<uintptr_t>(data);
+  const uintptr_t begin = (addr + page - 1) & ~(page - 1);
+  const uintptr_t end = (addr + bytes) & ~(page - 1);
+  if (end > begin) {
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+  }
+}
+#endif
+
+// Fault in the pages of fresh pixels from the pool instead of the caller
+// Call on fresh pixels only: pages are released, then tiles are zeroed by the
+// workers in parallel. Tiles are handed out dynamically, so this does not
+// place a page near the worker that later renders it
+void Tracer::prefault(Pixels& pixels) {
+  const int w = pixels.width;
+#ifdef __linux__
+  releasePages(pixels.pxColors.data(), pixels.pxColors.size() * sizeof(Color));
+  releasePages(pixels.pxSamples.data(), pixels.pxSamples.size() * sizeof(int));
+  releasePages(pixels.pxLumaMean.data(),
+               pixels.pxLumaMean.size() * sizeof(float));
+  releasePages(pixels.pxLumaM2.data(), pixels.pxLumaM2.size() * sizeof(float));
+  releasePages(pixels.pxDepth.data(), pixels.pxDepth.size() * sizeof(float));
+  releasePages(pixels.pxNormal.data(),
+               pixels.pxNormal.size() * sizeof(Vector));
+#endif
+  pool.parallelFor(0, pixels.numTiles(), 1, [&](int begin, int end) {
+    for (int t = begin; t < end; ++t) {
+      const Tile& tile = pixels.tiles[t];
+      for (int y = tile.y0; y < tile.y1; ++y) {
+        std::fill(pixels.pxColors.begin() + y * w + tile.x0,
+                  pixels.pxColors.begin() + y * w + tile.x1, Color());
+        std::fill(pixels.pxSamples.begin() + y * w + tile.x0,
+                  pixels.pxSamples.begin() + y * w + tile.x1, 0);
+        std::fill(pixels.pxLumaMean.begin() + y * w + tile.x0,
+                  pixels.pxLumaMean.begin() + y * w + tile.x1, 0.0f);
+        std::fill(pixels.pxLumaM2.begin() + y * w + tile.x0,
+                  pixels.pxLumaM2.begin() + y * w + tile.x1, 0.0f);
+        std::fill(pixels.pxDepth.begin() + y * w + tile.x0,
+                  pixels.pxDepth.begin() + y * w + tile.x1, 0.0f);
+        std::fill(pixels.pxNormal.begin() + y * w + tile.x0,
+                  pixels.pxNormal.begin() + y * w + tile.x1, Vector());
+      }
+    }
+  });
+}
+
+// Add one sample to every pixel of a tile for generation gen
+// Returns the number of samples traced
+int Tracer::renderTile(Pixels& pixels, const RayGenerator& rays, uint64_t gen,
+                       int index) const {
+  thread_local RayBatch batch;  // Reused, renderTile never nests
 
-        Ray ray = camera.ray(x + xOffset, row + yOffset, w, h);
-        Color c = traceRay(scene, ray, refl);
+  const int w = pixels.width;
+  const int refl = scene.reflections();
+  const Tile& tile = pixels.tiles[index];
+  const bool adaptive = adaptiveError > 0.0;
+
+  std::unique_lock<std::mutex> tileLock(pixels.tileLocks[index]);
+  if (pixels.currentGeneration() != gen) return 0;  // Stale pass
+  // Nothing left to refine in this tile
+  if (adaptive && pixels.tileConverged(index)) return 0;
+
+  // First pass of a new generation resets the tile
+  if (pixels.tileGeneration[index] != gen) {
+    for (int y = tile.y0; y < tile.y1; ++y) {
+      std::fill(pixels.pxColors.begin() + y * w + tile.x0,
+                pixels.pxColors.begin() + y * w + tile.x1, Color());
+      std::fill(pixels.pxSamples.begin() + y * w + tile.x0,
+                pixels.pxSamples.begin() + y * w + tile.x1, 0);
+      std::fill(pixels.pxLumaMean.begin() + y * w + tile.x0,
+                pixels.pxLumaMean.begin() + y * w + tile.x1, 0.0f);
+      std::fill(pixels.pxLumaM2.begin() + y * w + tile.x0,
+                pixels.pxLumaM2.begin() + y * w + tile.x1, 0.0f);
+    }
+    pixels.tileGeneration[index] = gen;
+  }
 
-        pixels.pxColors[i] += c;
-        pixels.pxSamples[i]++;
+  // A pixel is converged once its mean is known to within adaptiveError
+  auto converged = [&](int i) {
+    return pixels.pxSamples[i] >= adaptiveMinSamples &&
+           pixels.meanError(i) <= adaptiveError;
+  };
+  bool allConverged = true;
+  int traced = 0;
+
+  // Generate the tile's primary rays in one batch
+  batch.resize(tile.width() * tile.height());
+  for (int y = tile.y0, k = 0; y < tile.y1; ++y) {
+    for (int x = tile.x0; x < tile.x1; ++x, ++k) {
+      const SamplePoint s = sampler->get(x, y, pixels.pxSamples[y * w + x]);
+      batch.offsetX[k] = s.x;
+      batch.offsetY[k] = s.y;
+    }
+  }
+  rays.tile(tile.x0, tile.y0, tile.x1, tile.y1, batch);
+
+  for (int y = tile.y0, k = 0; y < tile.y1; ++y) {
+    // Camera moved: drop the rest of the tile, it is reset next pass
+    if (pixels.currentGeneration() != gen) return traced;
+
+    for (int x = tile.x0; x < tile.x1; ++x, ++k) {
+      const int i = y * w + x;
+      if (adaptive && converged(i)) continue;
+      // The generation's first sample records the surface for reprojection
+      const bool firstSample = pixels.pxSamples[i] == 0;
+      FirstHit hit;
+      Color c =
+          traceRay(scene, batch.ray(k), refl, firstSample ? &hit : nullptr);
+      if (firstSample) {
+        pixels.pxDepth[i] = hit.depth;
+        pixels.pxNormal[i] = hit.normal;
       }
-      // Mark row as ready
-      pixels.rowReady[row].store(true, std::memory_order_release);
-    });
+
+      pixels.pxColors[i] += c;
+      const int n = ++pixels.pxSamples[i];
+      traced++;
+
+      // Welford update of the luminance mean and squared deviations
+      const float luma = c.luminance();
+      const float delta = luma - pixels.pxLumaMean[i];
+      pixels.pxLumaMean[i] += delta / n;
+      pixels.pxLumaM2[i] += delta * (luma - pixels.pxLumaMean[i]);
+      if (adaptive && !converged(i)) allConverged = false;
+    }
+  }
+  if (adaptive && allConverged) {
+    pixels.tileConvergedGen[index].store(gen, std::memory_order_release);
   }
+  // Hand the tile to the display (which ignores it if generation is stale)
+  pixels.publishTile(index, gen);
+  return traced;
 }
 
-void Tracer::wait() { pool.wait(); }
+// Resolve tile t into its back frame slot and publish it for generation gen
+// Call with the tile's lock held; does nothing unless frames are enabled
+void Pixels::publishTile(int t, uint64_t gen) {
+  if (!frames) return;
+  const Tile& tile = tiles[t];
+  uint8_t* out = frames->back(t);
+  for (int y = tile.y0; y < tile.y1; ++y) {
+    const int i = y * width + tile.x0;
+    resolver.resolveRow(&pxColors[i], &pxSamples[i], tile.width(), out, 4);
+    out += tile.width() * 4;
+  }
+  frames->publish(t, gen);
+}
+
+// Expects preallocated pixels vector
+// Adds one sample per pixel, returning once the whole pass is done
+// With downscale > 1 the pixels cover the image at that fraction of its size
+void Tracer::renderPass(Pixels& pixels, Priority priority, int downscale) {
+  const RayGenerator rays = rayGenerator(downscale);
+  const uint64_t gen = pixels.currentGeneration();
+  pool.parallelFor(
+      0, pixels.numTiles(), 1,
+      [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) renderTile(pixels, rays, gen, t);
+      },
+      priority);
+}
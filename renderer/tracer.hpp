@@ -1,43 +1,146 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
 
 #include "math/color.hpp"
 #include "math/ray.hpp"
+#include "math/raygen.hpp"
 #include "pool.hpp"
+#include "renderer/framebuffer.hpp"
+#include "renderer/resolve.hpp"
+#include "renderer/sampler.hpp"
+#include "renderer/tiles.hpp"
 #include "scene/bvh.hpp"
 #include "scene/scene.hpp"
 
+// Accumulation buffer for progressive rendering
+// Each frame (camera position) is a generation. Work is split in tiles, which
+// are reset lazily by the first pass of a new generation, so starting a frame
+// never waits on tasks. Tasks write a tile under its lock and, for displayed
+// pixels, end by publishing its averaged colors to frames, which the display
+// reads lock-free
 struct Pixels {
+  static constexpr int DEFAULT_TILE_SIZE = 32;
+
+  const int width;
+  const int height;
   std::vector<int> pxSamples;   // Number of samples per pixel
   std::vector<Color> pxColors;  // Accumalated color per pixel (not averaged)
-  std::vector<std::atomic_bool> rowReady;  // Marks if row is ready for display
+  // Running mean and sum of squared deviations of each pixel's sample
+  // luminance (Welford), for adaptive sampling
+  std::vector<float> pxLumaMean;
+  std::vector<float> pxLumaM2;
+  // Distance and normal of the surface seen by the first sample of each pixel
+  // in its generation (negative depth for background), for reprojection
+  std::vector<float> pxDepth;
+  std::vector<Vector> pxNormal;
+  const std::vector<Tile> tiles;  // Work units, in the order to render them
+  std::unique_ptr<FrameBuffer> frames;  // Finished tiles, if displayed
+  Resolver resolver;  // 8-bit conversion, set before rendering
+  std::vector<uint64_t> tileGeneration;  // Generation of tile's samples
+  std::vector<std::mutex> tileLocks;     // Serializes tasks writing a tile
+  // Generation in which every pixel of the tile converged (adaptive only)
+  std::vector<std::atomic<uint64_t>> tileConvergedGen;
+  std::atomic<uint64_t> generation{1};   // Current frame generation
+
+  Pixels(int w, int h, int tileSize = DEFAULT_TILE_SIZE,
+         TileOrder order = TileOrder::Hilbert)
+      : width(w),
+        height(h),
+        pxSamples(w * h),
+        pxColors(w * h),
+        pxLumaMean(w * h),
+        pxLumaM2(w * h),
+        pxDepth(w * h),
+        pxNormal(w * h),
+        tiles(makeTiles(w, h, tileSize, order)),
+        tileGeneration(tiles.size(), 1),
+        tileLocks(tiles.size()),
+        tileConvergedGen(tiles.size()) {
+    for (std::atomic<uint64_t>& converged : tileConvergedGen) {
+      converged.store(0, std::memory_order_release);
+    }
+  }
+
+  int numTiles() const { return tiles.size(); }
+
+  // Publish finished tiles to frames for a display; call before rendering
+  // Offline pixels leave it off and skip the buffer and the resolve work
+  void enableFrames() { frames = std::make_unique<FrameBuffer>(tiles); }
+  void publishTile(int t, uint64_t gen);
+
+  // Standard error of pixel i's mean luminance (infinite below 2 samples)
+  double meanError(int i) const {
+    const int n = pxSamples[i];
+    if (n < 2) return std::numeric_limits<double>::infinity();
+    return std::sqrt(pxLumaM2[i] / (n * (n - 1.0)));
+  }
+
+  // Every pixel of tile t converged in the current generation
+  bool tileConverged(int t) const {
+    return tileConvergedGen[t].load(std::memory_order_acquire) ==
+           currentGeneration();
+  }
 
-  Pixels(int w, int h) : pxSamples(w * h), pxColors(w * h), rowReady(h) {
-    for (int y = 0; y < h; ++y) {
-      rowReady[y].store(false, std::memory_order_release);
+  // Adaptive sampling has nothing left to do for the current generation
+  bool converged() const {
+    for (int t = 0; t < numTiles(); ++t) {
+      if (!tileConverged(t)) return false;
     }
+    return true;
+  }
+
+  // Start a new generation: samples from older passes are dropped
+  void invalidate() { generation.fetch_add(1, std::memory_order_acq_rel); }
+  uint64_t currentGeneration() const {
+    return generation.load(std::memory_order_acquire);
   }
-  Pixels(const Pixels& px) = default;
-  Pixels& operator=(const Pixels& other) = default;
 };
 
-// Forward declaration
+// Surface hit by a primary ray
+// A miss has a negative depth: -ffast-math assumes no infinities
+struct FirstHit {
+  static constexpr float MISS = -1.0f;
+  float depth = MISS;  // Distance to the surface
+  Vector normal;
+};
+
+// Forward declarations
 class Renderer;
+class Refiner;
 
 // Responsible for tracing rays through the scene and computing pixel colors
 class Tracer {
  private:
-  static constexpr int ANTI_ALIAS_GRID_SIZE = 2;
-  const Color traceRay(const Scene& scene, const Ray& ray, int depth) const;
+  const Color traceRay(const Scene& scene, const Ray& ray, int depth,
+                       FirstHit* first = nullptr) const;
   const Color computeLighting(const Scene& scene, const HitInfo& hitInfo) const;
+  int renderTile(Pixels& pixels, const RayGenerator& rays, uint64_t gen,
+                 int index) const;
+  // Primary rays for the scene's current camera, optionally downscaled
+  RayGenerator rayGenerator(int downscale = 1) const {
+    return RayGenerator(scene.getCamera(), scene.getWidth(), scene.getHeight())
+        .downscaled(downscale);
+  }
   const Scene& scene;
-  BVH bvh;
-  ThreadPool pool{std::thread::hardware_concurrency()};
+  ThreadPool& pool;
+  const std::shared_ptr<const BVH> bvh;
+  std::shared_ptr<const Sampler> sampler = makeSampler(SamplerType::Sobol);
+  double adaptiveError = 0.0;  // Target meanError, 0 samples every pixel
+  int adaptiveMinSamples = 4;  // Samples before a pixel may be converged
 
  public:
-  Tracer(Scene& sc) : scene(sc), bvh(sc.bndedShapes) {
+  // Cheap to create: shares the pool and the scene's BVH
+  Tracer(Scene& sc, ThreadPool& threadPool = ThreadPool::shared())
+      : scene(sc), pool(threadPool), bvh(sc.getBVH(threadPool)) {
     std::function<void(const std::vector<BVHNode>&, int, int)> printNode =
         [&](const std::vector<BVHNode>& nodes, int index, int depth) {
           if (index < 0) return;
@@ -50,13 +153,26 @@ class Tracer {
           printNode(nodes, n.right, depth + 1);
         };
     // Uncomment to print BVH structure
-    // printNode(bvh.getNodes(), 0, 0);
+    // printNode(bvh->getNodes(), 0, 0);
+  }
+
+  // Only sample pixels whose meanError is above maxError (0 turns it off)
+  // Set before rendering; converged tiles are skipped until invalidated
+  void setAdaptiveSampling(double maxError, int minSamples = 4) {
+    adaptiveError = maxError;
+    adaptiveMinSamples = std::max(minSamples, 2);
   }
 
-  void refinePixels(Pixels& pixels);
-  void wait();
+  // Where samples go within each pixel; set before rendering
+  void setSampler(std::shared_ptr<const Sampler> s) { sampler = std::move(s); }
+  void setSampler(SamplerType type) { sampler = makeSampler(type); }
+
+  void prefault(Pixels& pixels);
+  void renderPass(Pixels& pixels, Priority priority = Priority::Refinement,
+                  int downscale = 1);
 
   ~Tracer() = default;
 
   friend class Renderer;
+  friend class Refiner;
 };
\ No newline at end of file
@@ -1,9 +1,51 @@
 #include "bvh.hpp"
 
 #include <array>
-#include <memory>
+#include <cmath>
+#include <limits>
 #include <numeric>
 
+// Bound on relative rounding error of 3 float operations (PBRT's gamma(3))
+static constexpr float FLOAT_GAMMA3 =
+    3.0f * (FLT_EPSILON * 0.5f) / (1.0f - 3.0f * (FLT_EPSILON * 0.5f));
+
+// Round double bounds outward so the float node encloses the double one
+FloatBVHNode::FloatBVHNode(const BVHNode& node)
+    : left(node.left),
+      right(node.right),
+      shapeIndex(node.shapeIndex),
+      shapeCount(node.shapeCount) {
+  for (int i = 0; i < 3; ++i) {
+    min[i] = static_cast<float>(node.bounds.min[i]);
+    max[i] = static_cast<float>(node.bounds.max[i]);
+    if (min[i] > node.bounds.min[i]) min[i] = std::nextafter(min[i], -INFINITY);
+    if (max[i] < node.bounds.max[i]) max[i] = std::nextafter(max[i], INFINITY);
+  }
+}
+
+// Conservative float ray-box test
+// Box is widened by the ray origin's rounding error and tmax by the
+// rounding error of the slab computation, so no double-precision hit is lost
+bool FloatBVHNode::intersects(const FloatRay& ray, float& tmin,
+                              float& tmax) const {
+  tmin = 0.0f;
+  tmax = FLT_MAX;
+
+  for (int i = 0; i < 3; ++i) {
+    float t0 = (min[i] - ray.origErr[i] - ray.orig[i]) * ray.invDir[i];
+    float t1 = (max[i] + ray.origErr[i] - ray.orig[i]) * ray.invDir[i];
+
+    if (ray.invDir[i] < 0.0f) std::swap(t0, t1);
+    t1 *= 1.0f + 2.0f * FLOAT_GAMMA3;
+
+    tmin = std::max(t0, tmin);
+    tmax = std::min(t1, tmax);
+
+    if (tmax < tmin) return false;
+  }
+  return true;
+}
+
 // Clear bin data
 void BVH::Bin::clear() {
   bounds = Bounds();
@@ -20,21 +62,49 @@ void BVH::Bin::add(const Bounds& b) {
   count++;
 }
 
+// Merge another bin into this one
+void BVH::Bin::merge(const Bin& other) {
+  if (other.count == 0) return;
+  if (count == 0) {
+    bounds = other.bounds;
+  } else {
+    bounds.expand(other.bounds);
+  }
+  count += other.count;
+}
+
+// Reduce body(b, e) over shape range [start, end), on the pool for large
+// ranges (results are exact: bounds unions and counts don't depend on order)
+template <class T, class Body, class Combine>
+T BVH::reduceShapes(int start, int end, const Body& body,
+                    const Combine& combine) {
+  if (!pool || end - start < PARALLEL_THRESHOLD) return body(start, end);
+  return pool->parallelReduce(start, end, PARALLEL_GRAIN, T(), body, combine,
+                              Priority::Interactive);
+}
+
 // Recursively build BVH and return index of this node
-int BVH::buildRecursive(
-    const std::vector<std::unique_ptr<BoundedShape>>& shapes, int start,
-    int end) {
-  // Compute bounds for this node
+int BVH::buildRecursive(const PrimitiveSet& shapes, int start, int end) {
+  // Compute bounds for this node and of the shape centroids
   const int n = end - start;
-  Bounds nodeBounds = shapes[shapeIndices[start]]->bounds;
-  Bounds centroidBounds = Bounds(shapes[shapeIndices[start]]->bounds.center);
-
-  // Already handled first shape
-  for (int i = start + 1; i < end; i++) {
-    const Bounds& b = shapes[shapeIndices[i]]->bounds;
-    nodeBounds.expand(b);
-    centroidBounds.expand(b.center);
-  }
+  const auto [nodeBin, centroidBin] = reduceShapes<std::pair<Bin, Bin>>(
+      start, end,
+      [&](int b, int e) {
+        std::pair<Bin, Bin> result;
+        for (int i = b; i < e; i++) {
+          const Bounds& bounds = shapes.bounds(shapeIndices[i]);
+          result.first.add(bounds);
+          result.second.add(Bounds(bounds.center));
+        }
+        return result;
+      },
+      [](std::pair<Bin, Bin> a, const std::pair<Bin, Bin>& b) {
+        a.first.merge(b.first);
+        a.second.merge(b.second);
+        return a;
+      });
+  const Bounds& nodeBounds = nodeBin.bounds;
+  const Bounds& centroidBounds = centroidBin.bounds;
 
   // Create node placeholder
   int nodeIndex = nodes.size();
@@ -55,7 +125,8 @@ int BVH::buildRecursive(
   if (extent.y() > extent.x()) axis = 1;
   if (extent.z() > extent[axis]) axis = 2;
 
-  auto [splitIndex, splitPos] = getBestSAHSplit(shapes, start, end, axis);
+  auto [splitIndex, splitPos] =
+      getBestSAHSplit(shapes, start, end, axis, nodeBounds, centroidBounds);
 
   if (splitIndex <= start || splitIndex >= end) {
     // SAH failed to find a good split, do median split
@@ -64,15 +135,15 @@ int BVH::buildRecursive(
     std::nth_element(shapeIndices.begin() + start,
                      shapeIndices.begin() + splitIndex,
                      shapeIndices.begin() + end, [&](int a, int b) {
-                       return shapes[a]->bounds.center[axis] <
-                              shapes[b]->bounds.center[axis];
+                       return shapes.bounds(a).center[axis] <
+                              shapes.bounds(b).center[axis];
                      });
   } else {
     // Partition shapes around split position found by SAH
     auto midIter =
         std::partition(shapeIndices.begin() + start, shapeIndices.begin() + end,
                        [&](int index) {
-                         return shapes[index]->bounds.center[axis] < splitPos;
+                         return shapes.bounds(index).center[axis] < splitPos;
                        });
     splitIndex = midIter - shapeIndices.begin();
   }
@@ -95,38 +166,40 @@ int BVH::buildRecursive(
 
 // Find best split using Surface Area Heuristic (SAH)
 // Returns pair of (split index, split position)
-std::pair<int, double> BVH::getBestSAHSplit(
-    const std::vector<std::unique_ptr<BoundedShape>>& shapes, int start,
-    int end, int axis) {
+std::pair<int, double> BVH::getBestSAHSplit(const PrimitiveSet& shapes,
+                                            int start, int end, int axis,
+                                            const Bounds& parentBounds,
+                                            const Bounds& centroidBounds) {
   const int n = end - start;
   if (n <= 2) return std::make_pair(start, 0.0);  // No split possible
 
-  // Compute node and centroid bounds
-  Bounds parentBounds = shapes[shapeIndices[start]]->bounds;
-  double centerMin = shapes[shapeIndices[start]]->bounds.center[axis];
-  double centerMax = centerMin;
-  for (int i = start + 1; i < end; i++) {
-    const Bounds& b = shapes[shapeIndices[i]]->bounds;
-    parentBounds.expand(b);
-    double c = b.center[axis];
-    if (c < centerMin) centerMin = c;
-    if (c > centerMax) centerMax = c;
-  }
+  const double centerMin = centroidBounds.min[axis];
+  const double centerMax = centroidBounds.max[axis];
 
   // If centroid bounds is degenerate, cannot split
   if (centerMax - centerMin < Vector::EPS) return std::make_pair(start, 0.0);
 
   // Initialize and fill bins
-  std::vector<Bin> bins(BIN_COUNT);
+  using Bins = std::array<Bin, BIN_COUNT>;
   const double extentInv = 1.0 / (centerMax - centerMin);
-  for (int i = start; i < end; ++i) {
-    const Bounds& b = shapes[shapeIndices[i]]->bounds;
-    double c = b.center[axis];
-    int binIndex =
-        std::min(static_cast<int>(BIN_COUNT * (c - centerMin) * extentInv),
-                 BIN_COUNT - 1);
-    bins[binIndex].add(b);
-  }
+  const Bins bins = reduceShapes<Bins>(
+      start, end,
+      [&](int b, int e) {
+        Bins result;
+        for (int i = b; i < e; ++i) {
+          const Bounds& bounds = shapes.bounds(shapeIndices[i]);
+          double c = bounds.center[axis];
+          int binIndex = std::min(
+              static_cast<int>(BIN_COUNT * (c - centerMin) * extentInv),
+              BIN_COUNT - 1);
+          result[binIndex].add(bounds);
+        }
+        return result;
+      },
+      [](Bins a, const Bins& b) {
+        for (int i = 0; i < BIN_COUNT; ++i) a[i].merge(b[i]);
+        return a;
+      });
 
   // Build prefix arrays for bins
   std::vector<Bounds> prefixBounds(BIN_COUNT);
@@ -188,17 +261,22 @@ std::pair<int, double> BVH::getBestSAHSplit(
       centerMin + (bestBin + 1) * (centerMax - centerMin) / BIN_COUNT;
 
   // Count how many shapes go to the left of the split
-  int leftCount = 0;
-  for (int i = start; i < end; ++i) {
-    const Bounds& b = shapes[shapeIndices[i]]->bounds;
-    if (b.center[axis] < splitPos) {
-      leftCount++;
-    }
-  }
+  const int leftCount = reduceShapes<int>(
+      start, end,
+      [&](int b, int e) {
+        int count = 0;
+        for (int i = b; i < e; ++i) {
+          if (shapes.bounds(shapeIndices[i]).center[axis] < splitPos) count++;
+        }
+        return count;
+      },
+      [](int a, int b) { return a + b; });
   return std::make_pair(start + leftCount, splitPos);
 }
 
-void BVH::build(const std::vector<std::unique_ptr<BoundedShape>>& shapes) {
+void BVH::build(const PrimitiveSet& shapes, ThreadPool* buildPool) {
+  pool = buildPool;
+
   // Initialize shape indices
   shapeIndices.resize(shapes.size());
   std::iota(shapeIndices.begin(), shapeIndices.end(), 0);
@@ -211,11 +289,18 @@ void BVH::build(const std::vector<std::unique_ptr<BoundedShape>>& shapes) {
 
   // Build BVH recursively
   buildRecursive(shapes, 0, shapes.size());
+  pool = nullptr;
+
+  // Mirror nodes in single precision
+  floatNodes.clear();
+  floatNodes.reserve(nodes.size());
+  for (const BVHNode& node : nodes) {
+    floatNodes.emplace_back(node);
+  }
 }
 
 // Traverse BVH with ray and invoke callback on hits
-void BVH::traverse(const std::vector<std::unique_ptr<BoundedShape>>& shapes,
-                   const Ray& ray,
+void BVH::traverse(const PrimitiveSet& shapes, const Ray& ray,
                    const std::function<void(const HitInfo&)>& callback) const {
   if (nodes.empty()) return;
 
@@ -244,7 +329,7 @@ void BVH::traverse(const std::vector<std::unique_ptr<BoundedShape>>& shapes,
       // Leaf node: test all shapes in this node
       for (int i = 0; i < node.shapeCount; ++i) {
         std::optional<HitInfo> hitOpt =
-            shapes[shapeIndices[node.shapeIndex + i]]->intersects(ray);
+            shapes.intersects(shapeIndices[node.shapeIndex + i], ray);
         if (hitOpt.has_value()) {
           callback(hitOpt.value());
         }
@@ -257,11 +342,30 @@ void BVH::traverse(const std::vector<std::unique_ptr<BoundedShape>>& shapes,
   }
 }
 
-void BVH::traverseFirstHit(
-    const std::vector<std::unique_ptr<BoundedShape>>& shapes, const Ray& ray,
-    const std::function<void(const HitInfo&)>& callback) const {
+void BVH::traverseFirstHit(const PrimitiveSet& shapes, const Ray& ray,
+                           const std::function<void(const HitInfo&)>& callback,
+                           Precision precision) const {
   if (nodes.empty()) return;
 
+  if (precision != Precision::Double) {
+    // Any hit will do, so triangles are tested in float only
+    const FloatRay floatRay(ray);
+    traverseFloat(floatRay, [&](int shape) {
+      const int tri = shapes.triangleIndex(shape);
+      if (tri >= 0) {
+        const float t = shapes.getFloatTriangle(tri).intersects(floatRay);
+        if (t < 0.0f) return false;
+        callback(shapes.getTriangle(tri).hitAt(ray, t));
+        return true;
+      }
+      std::optional<HitInfo> hitOpt = shapes.intersects(shape, ray);
+      if (!hitOpt.has_value()) return false;
+      callback(hitOpt.value());
+      return true;
+    });
+    return;
+  }
+
   struct StackItem {
     int nodeIndex;
     double tmin;
@@ -287,7 +391,7 @@ void BVH::traverseFirstHit(
       // Leaf node: test all shapes in this node
       for (int i = 0; i < node.shapeCount; ++i) {
         std::optional<HitInfo> hitOpt =
-            shapes[shapeIndices[node.shapeIndex + i]]->intersects(ray);
+            shapes.intersects(shapeIndices[node.shapeIndex + i], ray);
         if (hitOpt.has_value()) {
           callback(hitOpt.value());
           return;  // Stop after first hit
@@ -299,4 +403,56 @@ void BVH::traverseFirstHit(
       if (node.left >= 0) stack.emplace_back(StackItem{node.left, tmin});
     }
   }
-}
\ No newline at end of file
+}
+
+// Find the closest hit along the ray
+// Float modes test triangles in float and keep only the closest one's
+// distance; FloatRefined re-intersects that triangle alone in double
+std::optional<HitInfo> BVH::closestHit(const PrimitiveSet& shapes,
+                                       const Ray& ray,
+                                       Precision precision) const {
+  std::optional<HitInfo> closestHit;
+  double closestT = std::numeric_limits<double>::max();
+
+  if (precision == Precision::Double) {
+    traverse(shapes, ray, [&](const HitInfo& hitInfo) {
+      if (hitInfo.t < closestT) {
+        closestT = hitInfo.t;
+        closestHit.emplace(hitInfo);
+      }
+    });
+    return closestHit;
+  }
+
+  const FloatRay floatRay(ray);
+  int closestTri = -1;  // Set when the closest hit so far is a float triangle
+
+  traverseFloat(floatRay, [&](int shape) {
+    const int tri = shapes.triangleIndex(shape);
+    if (tri >= 0) {
+      const float t = shapes.getFloatTriangle(tri).intersects(floatRay);
+      if (t >= 0.0f && t < closestT) {
+        closestT = t;
+        closestTri = tri;
+      }
+    } else {
+      std::optional<HitInfo> hitOpt = shapes.intersects(shape, ray);
+      if (hitOpt.has_value() && hitOpt->t < closestT) {
+        closestT = hitOpt->t;
+        closestTri = -1;
+        closestHit.emplace(hitOpt.value());
+      }
+    }
+    return false;
+  });
+
+  if (closestTri < 0) return closestHit;
+
+  const Triangle& triangle = shapes.getTriangle(closestTri);
+  if (precision == Precision::FloatRefined) {
+    std::optional<HitInfo> refined = triangle.intersects(ray);
+    // Double test may reject hits on shared edges the watertight test keeps
+    if (refined.has_value()) return refined;
+  }
+  return triangle.hitAt(ray, closestT);
+}
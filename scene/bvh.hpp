@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cfloat>
 #include <functional>
-#include <memory>
+#include <optional>
 #include <vector>
 
+#include "math/ray.hpp"
+#include "renderer/pool.hpp"
+#include "scene/primitives.hpp"
 #include "shapes/shape.hpp"
 
 struct BVHNode {
@@ -18,20 +22,38 @@ struct BVHNode {
   BVHNode() : bounds(), left(-1), right(-1), shapeIndex(-1), shapeCount(0) {}
 };
 
+// Single-precision copy of a BVH node (bounds rounded outward)
+struct FloatBVHNode {
+  float min[3];
+  float max[3];
+  int left;
+  int right;
+  int shapeIndex;
+  int shapeCount;
+
+  FloatBVHNode(const BVHNode& node);
+  bool intersects(const FloatRay& ray, float& tmin, float& tmax) const;
+};
+
+// Precision used for BVH traversal and triangle tests
+enum class Precision {
+  Double,       // Double precision everywhere (reference path)
+  Float,        // Float traversal and watertight float triangle tests
+  FloatRefined  // Float path, closest hit re-intersected in double
+};
+
 class BVH {
  private:
   std::vector<BVHNode> nodes;
+  std::vector<FloatBVHNode> floatNodes;  // Mirrors nodes for float traversal
   std::vector<int> shapeIndices;
+  ThreadPool* pool = nullptr;  // Splits large nodes while building, if set
   static constexpr int LEAF_THRESHOLD = 4;
   static constexpr int BIN_COUNT = 32;
   static constexpr double TRAVERSAL_COST = 1.0;
   static constexpr double INTERSECTION_COST = 1.0;
-
-  int buildRecursive(const std::vector<std::unique_ptr<BoundedShape>>& shapes,
-                     int start, int end);
-  std::pair<int, double> getBestSAHSplit(
-      const std::vector<std::unique_ptr<BoundedShape>>& shapes, int start,
-      int end, int axis);
+  static constexpr int PARALLEL_THRESHOLD = 4096;  // Shapes per node
+  static constexpr int PARALLEL_GRAIN = 1024;
 
   struct Bin {
     Bounds bounds;
@@ -39,28 +61,79 @@ class BVH {
 
     void clear();
     void add(const Bounds& b);
+    void merge(const Bin& other);
 
     Bin() : bounds(), count(0) {}
 
     ~Bin() = default;
   };
 
+  int buildRecursive(const PrimitiveSet& shapes, int start, int end);
+  std::pair<int, double> getBestSAHSplit(const PrimitiveSet& shapes,
+                                         int start, int end, int axis,
+                                         const Bounds& parentBounds,
+                                         const Bounds& centroidBounds);
+  template <class T, class Body, class Combine>
+  T reduceShapes(int start, int end, const Body& body, const Combine& combine);
+  template <class F>
+  void traverseFloat(const FloatRay& ray, F&& visitLeafShape) const;
+
  public:
-  BVH(const std::vector<std::unique_ptr<BoundedShape>>& shapes)
+  BVH(const PrimitiveSet& shapes, ThreadPool* buildPool = nullptr)
       : nodes(), shapeIndices() {
-    build(shapes);
+    build(shapes, buildPool);
   }
 
   const std::vector<BVHNode>& getNodes() const { return nodes; }
   const std::vector<int>& getShapeIndices() const { return shapeIndices; }
 
-  void build(const std::vector<std::unique_ptr<BoundedShape>>& shapes);
-  void traverse(const std::vector<std::unique_ptr<BoundedShape>>& shapes,
-                const Ray& ray,
+  void build(const PrimitiveSet& shapes, ThreadPool* buildPool = nullptr);
+  void traverse(const PrimitiveSet& shapes, const Ray& ray,
                 const std::function<void(const HitInfo&)>& callback) const;
   void traverseFirstHit(
-      const std::vector<std::unique_ptr<BoundedShape>>& shapes, const Ray& ray,
-      const std::function<void(const HitInfo&)>& callback) const;
+      const PrimitiveSet& shapes, const Ray& ray,
+      const std::function<void(const HitInfo&)>& callback,
+      Precision precision = Precision::Double) const;
+  std::optional<HitInfo> closestHit(
+      const PrimitiveSet& shapes, const Ray& ray,
+      Precision precision = Precision::Double) const;
 
   ~BVH() = default;
-};
\ No newline at end of file
+};
+
+// Traverse float nodes, calling visitLeafShape(shapeIndex) for every shape
+// in every leaf the ray reaches; stops early when it returns true
+template <class F>
+void BVH::traverseFloat(const FloatRay& ray, F&& visitLeafShape) const {
+  if (floatNodes.empty()) return;
+
+  struct StackItem {
+    int nodeIndex;
+    float tmin;
+  };
+
+  std::vector<StackItem> stack;
+  stack.emplace_back(StackItem{0, 0.0f});
+
+  while (!stack.empty()) {
+    StackItem item = stack.back();
+    stack.pop_back();
+
+    const FloatBVHNode& node = floatNodes[item.nodeIndex];
+
+    // Check if ray intersects node bounds
+    float tmin, tmax;
+    if (!node.intersects(ray, tmin, tmax)) continue;
+    if (tmax < item.tmin) continue;
+
+    if (node.shapeCount > 0) {
+      for (int i = 0; i < node.shapeCount; ++i) {
+        if (visitLeafShape(shapeIndices[node.shapeIndex + i])) return;
+      }
+    } else {
+      // Internal node: push children onto stack (left then right)
+      if (node.right >= 0) stack.emplace_back(StackItem{node.right, tmin});
+      if (node.left >= 0) stack.emplace_back(StackItem{node.left, tmin});
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#include "primitives.hpp"
+
+void PrimitiveSet::add(const Sphere& sphere) {
+  refs.push_back(PrimRef{ShapeType::Sphere, static_cast<int>(spheres.size())});
+  spheres.push_back(sphere);
+}
+
+void PrimitiveSet::add(const Triangle& triangle) {
+  refs.push_back(
+      PrimRef{ShapeType::Triangle, static_cast<int>(triangles.size())});
+  triangles.push_back(triangle);
+  floatTriangles.push_back(FloatTriangle(triangle));
+}
+
+void PrimitiveSet::add(const Box& box) {
+  refs.push_back(PrimRef{ShapeType::Box, static_cast<int>(boxes.size())});
+  boxes.push_back(box);
+}
+
+void PrimitiveSet::add(const Quad& quad) {
+  refs.push_back(PrimRef{ShapeType::Quad, static_cast<int>(quads.size())});
+  quads.push_back(quad);
+}
+
+void PrimitiveSet::add(const Disk& disk) {
+  refs.push_back(PrimRef{ShapeType::Disk, static_cast<int>(disks.size())});
+  disks.push_back(disk);
+}
+
+void PrimitiveSet::add(const TransformedInstance& instance) {
+  refs.push_back(
+      PrimRef{ShapeType::Instance, static_cast<int>(instances.size())});
+  instances.push_back(instance);
+}
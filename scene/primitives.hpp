@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "shapes/box.hpp"
+#include "shapes/disk.hpp"
+#include "shapes/instance.hpp"
+#include "shapes/quad.hpp"
+#include "shapes/shape.hpp"
+#include "shapes/sphere.hpp"
+#include "shapes/triangle.hpp"
+
+// Closed set of bounded primitive kinds stored by a PrimitiveSet
+enum class ShapeType : uint8_t { Sphere, Triangle, Box, Quad, Disk, Instance };
+
+// Reference to a primitive: its kind and index into that kind's array
+struct PrimRef {
+  ShapeType type;
+  int index;
+};
+
+// Stores bounded primitives in contiguous per-type arrays
+// Intersection dispatches on the type tag, so shape calls are direct
+// (non-virtual) and can be inlined
+class PrimitiveSet {
+ private:
+  std::vector<Sphere> spheres;
+  std::vector<Triangle> triangles;
+  std::vector<Box> boxes;
+  std::vector<Quad> quads;
+  std::vector<Disk> disks;
+  std::vector<TransformedInstance> instances;
+  std::vector<FloatTriangle> floatTriangles;  // Float copies of triangles
+  std::vector<PrimRef> refs;  // Primitive index -> (type, index)
+
+ public:
+  PrimitiveSet() = default;
+
+  void add(const Sphere& sphere);
+  void add(const Triangle& triangle);
+  void add(const Box& box);
+  void add(const Quad& quad);
+  void add(const Disk& disk);
+  void add(const TransformedInstance& instance);
+
+  size_t size() const { return refs.size(); }
+  bool empty() const { return refs.empty(); }
+
+  // Index into the triangle arrays of the i-th primitive (-1 if not one)
+  int triangleIndex(int i) const {
+    return refs[i].type == ShapeType::Triangle ? refs[i].index : -1;
+  }
+  const Triangle& getTriangle(int t) const { return triangles[t]; }
+  const FloatTriangle& getFloatTriangle(int t) const {
+    return floatTriangles[t];
+  }
+
+  // Bounds of the i-th primitive
+  const Bounds& bounds(int i) const {
+    const PrimRef& ref = refs[i];
+    switch (ref.type) {
+      case ShapeType::Sphere:
+        return spheres[ref.index].bounds;
+      case ShapeType::Triangle:
+        return triangles[ref.index].bounds;
+      case ShapeType::Box:
+        return boxes[ref.index].bounds;
+      case ShapeType::Quad:
+        return quads[ref.index].bounds;
+      case ShapeType::Disk:
+        return disks[ref.index].bounds;
+      case ShapeType::Instance:
+        break;
+    }
+    return instances[ref.index].bounds;
+  }
+
+  // Returns HitInfo if the i-th primitive is hit, std::nullopt otherwise
+  std::optional<HitInfo> intersects(int i, const Ray& ray) const {
+    const PrimRef& ref = refs[i];
+    switch (ref.type) {
+      case ShapeType::Sphere:
+        return spheres[ref.index].intersects(ray);
+      case ShapeType::Triangle:
+        return triangles[ref.index].intersects(ray);
+      case ShapeType::Box:
+        return boxes[ref.index].intersects(ray);
+      case ShapeType::Quad:
+        return quads[ref.index].intersects(ray);
+      case ShapeType::Disk:
+        return disks[ref.index].intersects(ray);
+      case ShapeType::Instance:
+        break;
+    }
+    return instances[ref.index].intersects(ray);
+  }
+
+  ~PrimitiveSet() = default;
+};
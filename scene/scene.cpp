@@ -3,7 +3,11 @@
 #include "light.hpp"
 #include "math/color.hpp"
 #include "math/vector.hpp"
+#include "shapes/box.hpp"
+#include "shapes/disk.hpp"
+#include "shapes/instance.hpp"
 #include "shapes/plane.hpp"
+#include "shapes/quad.hpp"
 #include "shapes/sphere.hpp"
 #include "shapes/triangle.hpp"
 
@@ -30,6 +34,9 @@ void Scene::zoomCamera(double scroll) { camera.zoom(scroll); }
 
 void Scene::setAmbientLight(const double ambient) { ambientLight = ambient; }
 
+// Select float or double intersection path (see Precision)
+void Scene::setPrecision(const Precision prec) { precision = prec; }
+
 // Set background color
 void Scene::setBackground(const int r, const int g, const int b) {
   background = Color(r, g, b);
@@ -40,12 +47,34 @@ void Scene::addLight(const Vector pos, const Color color) {
   lights.push_back(Light{pos, color});
 }
 
+// BVH over the bounded shapes, built on the pool the first time it's needed
+// Shared by every tracer of this scene (and its copies) until shapes change
+// Tracers may be built on several threads at once. The build itself runs
+// unlocked, since it joins pool workers that could otherwise be stuck here;
+// if two threads race, the first BVH published wins
+std::shared_ptr<const BVH> Scene::getBVH(ThreadPool& pool) {
+  {
+    std::unique_lock<std::mutex> lock(bvhMtx);
+    if (bvh) return bvh;
+  }
+  auto built = std::make_shared<const BVH>(bndedShapes, &pool);
+  std::unique_lock<std::mutex> lock(bvhMtx);
+  if (!bvh) bvh = std::move(built);
+  return bvh;
+}
+
+// Drop the BVH after the shapes changed; the next getBVH builds a new one
+void Scene::resetBVH() {
+  std::unique_lock<std::mutex> lock(bvhMtx);
+  bvh.reset();
+}
+
 void Scene::addPlane(const Vector& point, const Vector& normal,
                      const Material& mat) {
   if (normal.magSq() < Vector::EPS * Vector::EPS) {
     throw std::invalid_argument("Plane normal cannot be zero vector");
   }
-  planes.push_back(std::make_unique<Plane>(point, normal.norm(), mat));
+  planes.add(point, normal.norm(), mat);
 }
 
 void Scene::addSphere(const Vector& center, double radius,
@@ -53,10 +82,53 @@ void Scene::addSphere(const Vector& center, double radius,
   if (radius < Vector::EPS) {
     throw std::invalid_argument("Sphere radius must be positive");
   }
-  bndedShapes.push_back(std::make_unique<Sphere>(center, radius, mat));
+  bndedShapes.add(Sphere(center, radius, mat));
+  resetBVH();
 }
 
 void Scene::addTriangle(const Vector& a, const Vector& b, const Vector& c,
                         const Material& mat) {
-  bndedShapes.push_back(std::make_unique<Triangle>(a, b, c, mat));
+  bndedShapes.add(Triangle(a, b, c, mat));
+  resetBVH();
+}
+
+// Add a parallelogram spanned by edgeU and edgeV from corner
+// Prefer this over addPlane for finite floors and walls (it joins the BVH)
+void Scene::addQuad(const Vector& corner, const Vector& edgeU,
+                    const Vector& edgeV, const Material& mat) {
+  if (edgeU.cross(edgeV).magSq() < Vector::EPS * Vector::EPS) {
+    throw std::invalid_argument("Quad edges must not be parallel or zero");
+  }
+  bndedShapes.add(Quad(corner, edgeU, edgeV, mat));
+  resetBVH();
+}
+
+void Scene::addDisk(const Vector& center, const Vector& normal, double radius,
+                    const Material& mat) {
+  if (normal.magSq() < Vector::EPS * Vector::EPS) {
+    throw std::invalid_argument("Disk normal cannot be zero vector");
+  }
+  if (radius < Vector::EPS) {
+    throw std::invalid_argument("Disk radius must be positive");
+  }
+  bndedShapes.add(Disk(center, normal, radius, mat));
+  resetBVH();
+}
+
+void Scene::addBox(const Vector& min, const Vector& max, const Material& mat) {
+  if (min.x() > max.x() || min.y() > max.y() || min.z() > max.z()) {
+    throw std::invalid_argument("Box min corner must not exceed max corner");
+  }
+  bndedShapes.add(Box(min, max, mat));
+  resetBVH();
+}
+
+// Add shared geometry (shape or mesh) placed with an affine transform
+void Scene::addInstance(std::shared_ptr<const BoundedShape> shape,
+                        const Transform& transform) {
+  if (!shape) {
+    throw std::invalid_argument("Instance shape cannot be null");
+  }
+  bndedShapes.add(TransformedInstance(std::move(shape), transform));
+  resetBVH();
 }
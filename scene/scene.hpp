@@ -2,12 +2,16 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #include "math/camera.hpp"
 #include "math/color.hpp"
 #include "math/ray.hpp"
+#include "math/transform.hpp"
 #include "math/vector.hpp"
+#include "scene/bvh.hpp"
 #include "scene/light.hpp"
+#include "scene/primitives.hpp"
 #include "shapes/plane.hpp"
 #include "shapes/shape.hpp"
 
@@ -22,11 +26,16 @@ class Scene {
   const int height;
   const int maxReflections;
   double ambientLight;
+  Precision precision;
   Camera camera;
   Color background;
   std::vector<Light> lights;
-  std::vector<std::unique_ptr<BoundedShape>> bndedShapes;
-  std::vector<std::unique_ptr<Plane>> planes;
+  PrimitiveSet bndedShapes;
+  PlaneSet planes;
+  std::shared_ptr<const BVH> bvh;  // Built on first use, reset on new shapes
+  mutable std::mutex bvhMtx;       // Guards bvh
+
+  void resetBVH();
 
  public:
   Scene(const int w, const int h, const int maxRefl)
@@ -34,6 +43,7 @@ class Scene {
         height(h),
         maxReflections(maxRefl),
         ambientLight(),
+        precision(Precision::Double),
         camera(),
         background(),
         lights() {}
@@ -42,29 +52,25 @@ class Scene {
         height(other.height),
         maxReflections(other.maxReflections),
         ambientLight(other.ambientLight),
+        precision(other.precision),
         camera(other.camera),
         background(other.background),
         lights(other.lights),
-        bndedShapes(),
-        planes() {
-    // Deep copy of bounded shapes
-    for (const std::unique_ptr<BoundedShape>& bshape : other.bndedShapes) {
-      bndedShapes.push_back(std::unique_ptr<BoundedShape>(
-          static_cast<BoundedShape*>(bshape->clone())));
-    }
-    // Deep copy of planes
-    for (const std::unique_ptr<Plane>& shape : other.planes) {
-      planes.push_back(std::unique_ptr<Plane>(shape->clone()));
-    }
+        bndedShapes(other.bndedShapes),
+        planes(other.planes) {
+    std::unique_lock<std::mutex> lock(other.bvhMtx);
+    bvh = other.bvh;
   }
 
   int getWidth() const { return width; }
   int getHeight() const { return height; }
   int reflections() const { return maxReflections; }
   double getAmbientLight() const { return ambientLight; }
+  Precision getPrecision() const { return precision; }
   const Color getBackground() const { return background; }
   const Camera getCamera() const { return camera; }
   void setAmbientLight(const double ambient);
+  void setPrecision(const Precision prec);
   void setCamera(const Vector pos, const Vector dir, const double fovDeg);
   void setCameraPos(const Vector pos);
   void setCameraDir(const Vector dir);
@@ -74,11 +80,19 @@ class Scene {
   void zoomCamera(double scroll);
   void setBackground(const int r, const int g, const int b);
   void addLight(const Vector pos, const Color color);
+  std::shared_ptr<const BVH> getBVH(ThreadPool& pool);
 
   void addPlane(const Vector& point, const Vector& normal, const Material& mat);
   void addSphere(const Vector& center, double radius, const Material& mat);
   void addTriangle(const Vector& a, const Vector& b, const Vector& c,
                    const Material& mat);
+  void addQuad(const Vector& corner, const Vector& edgeU, const Vector& edgeV,
+               const Material& mat);
+  void addDisk(const Vector& center, const Vector& normal, double radius,
+               const Material& mat);
+  void addBox(const Vector& min, const Vector& max, const Material& mat);
+  void addInstance(std::shared_ptr<const BoundedShape> shape,
+                   const Transform& transform);
 
   friend class Tracer;
   friend class Renderer;
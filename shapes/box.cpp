@@ -13,6 +13,7 @@ Box::Box(const Vector& center, double width, double height, double depth,
 std::optional<HitInfo> Box::intersects(const Ray& ray) const {
   double tmin = std::numeric_limits<double>::lowest();
   double tmax = std::numeric_limits<double>::max();
+  int tminAxis = 0, tmaxAxis = 0;  // Slab that produced tmin/tmax
 
   // For each axis, compute intersection with that axis's slabs
   for (int i = 0; i < 3; ++i) {
@@ -22,33 +23,29 @@ std::optional<HitInfo> Box::intersects(const Ray& ray) const {
 
     if (invD < 0.0) std::swap(t0, t1);
 
-    tmin = std::max(tmin, t0);
-    tmax = std::min(tmax, t1);
+    if (t0 > tmin) {
+      tmin = t0;
+      tminAxis = i;
+    }
+    if (t1 < tmax) {
+      tmax = t1;
+      tmaxAxis = i;
+    }
 
     if (tmax < tmin) return std::nullopt;  // No hit
   }
 
-  double t = (tmin > Vector::EPS) ? tmin : tmax;
+  // Entering hit uses the tmin slab, hits from inside use the tmax slab
+  const bool entering = tmin > Vector::EPS;
+  double t = entering ? tmin : tmax;
   if (t < Vector::EPS) return std::nullopt;
 
-  Vector pos = ray.at(t);
-
-  // Compute normal: check which face we hit
-  Vector normal(0, 0, 0);
-
-  if (std::abs(pos.x() - min.x()) < Vector::EPS)
-    normal = Vector(-1, 0, 0);
-  else if (std::abs(pos.x() - max.x()) < Vector::EPS)
-    normal = Vector(1, 0, 0);
-  else if (std::abs(pos.y() - min.y()) < Vector::EPS)
-    normal = Vector(0, -1, 0);
-  else if (std::abs(pos.y() - max.y()) < Vector::EPS)
-    normal = Vector(0, 1, 0);
-  else if (std::abs(pos.z() - min.z()) < Vector::EPS)
-    normal = Vector(0, 0, -1);
-  else if (std::abs(pos.z() - max.z()) < Vector::EPS)
-    normal = Vector(0, 0, 1);
-
-  const HitInfo hitInfo(pos, normal, ray, t, &material);
+  // Normal faces against the ray when entering and along it when exiting
+  const int axis = entering ? tminAxis : tmaxAxis;
+  const double sign = (ray.dir[axis] < 0.0) == entering ? 1.0 : -1.0;
+  const Vector normal(axis == 0 ? sign : 0.0, axis == 1 ? sign : 0.0,
+                      axis == 2 ? sign : 0.0);
+
+  const HitInfo hitInfo(ray.at(t), normal, ray, t, &material);
   return hitInfo;
 }
\ No newline at end of file
@@ -5,8 +5,8 @@
 #include "math/vector.hpp"
 #include "shape.hpp"
 
-// Represents a sphere in 3D space
-class Box : public BoundedShape {
+// Represents an axis-aligned box in 3D space
+class Box final : public BoundedShape {
  public:
   const Vector min;
   const Vector max;
@@ -16,5 +16,4 @@ class Box : public BoundedShape {
   Box(const Vector& center, double width, double height, double depth,
       const Material& mat);
   std::optional<HitInfo> intersects(const Ray& ray) const override;
-  Box* clone() const override { return new Box(*this); }
 };
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "disk.hpp"
+
+#include <cmath>
+
+// Tight bounding box of a disk: extent along each axis is r * sqrt(1 - n_i^2)
+// (padded so axis-aligned disks have thickness)
+static Bounds diskBounds(const Vector& c, const Vector& norm, double r) {
+  const Vector n = norm.norm();
+  const Vector extent(r * std::sqrt(std::max(0.0, 1.0 - n.x() * n.x())),
+                      r * std::sqrt(std::max(0.0, 1.0 - n.y() * n.y())),
+                      r * std::sqrt(std::max(0.0, 1.0 - n.z() * n.z())));
+  return Bounds(c - extent - Vector(Vector::EPS),
+                c + extent + Vector(Vector::EPS));
+}
+
+Disk::Disk(const Vector& cen, const Vector& norm, double r,
+           const Material& mat)
+    : BoundedShape(mat, diskBounds(cen, norm, r)),
+      center(cen),
+      normal(norm.norm()),
+      radius(r) {}
+
+// Intersect supporting plane, then check distance from center
+std::optional<HitInfo> Disk::intersects(const Ray& ray) const {
+  double denom = normal.dot(ray.dir);
+
+  // Ray is essentially parallel to the disk, no intersection
+  if (std::abs(denom) < Vector::EPS) return std::nullopt;
+
+  double t = (center - ray.orig).dot(normal) / denom;
+  if (t < Vector::EPS) return std::nullopt;
+
+  const Vector pos = ray.at(t);
+  if ((pos - center).magSq() > radius * radius) return std::nullopt;
+
+  return HitInfo(pos, normal, ray, t, &material);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <optional>
+
+#include "math/vector.hpp"
+#include "shape.hpp"
+
+// Represents a flat circular disk
+class Disk final : public BoundedShape {
+ public:
+  const Vector center;
+  const Vector normal;
+  const double radius;
+
+  Disk(const Vector& cen, const Vector& norm, double r, const Material& mat);
+  std::optional<HitInfo> intersects(const Ray& ray) const override;
+};
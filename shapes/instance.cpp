@@ -0,0 +1,38 @@
+#include "instance.hpp"
+
+#include "math/vector.hpp"
+
+// World-space bounds enclosing all 8 transformed corners of the object bounds
+static Bounds worldBounds(const Bounds& b, const Transform& transform) {
+  Bounds result;
+  for (int i = 0; i < 8; ++i) {
+    const Vector corner((i & 1) ? b.max.x() : b.min.x(),
+                        (i & 2) ? b.max.y() : b.min.y(),
+                        (i & 4) ? b.max.z() : b.min.z());
+    result.expand(transform.applyPoint(corner));
+  }
+  return result;
+}
+
+TransformedInstance::TransformedInstance(
+    std::shared_ptr<const BoundedShape> shp, const Transform& transform)
+    : BoundedShape(Material{}, worldBounds(shp->bounds, transform)),
+      shape(std::move(shp)),
+      toWorld(transform),
+      toObject(transform.inverse()) {}
+
+// Intersect in object space, then map the hit back to world space
+// Ray direction is not renormalized, so t is the same in both spaces
+std::optional<HitInfo> TransformedInstance::intersects(const Ray& ray) const {
+  const Ray localRay(toObject.applyPoint(ray.orig),
+                     toObject.applyVector(ray.dir));
+
+  std::optional<HitInfo> localHit = shape->intersects(localRay);
+  if (!localHit.has_value()) return std::nullopt;
+
+  // Normals transform by the inverse transpose of the object -> world matrix
+  const Vector normal = toObject.applyTransposed(localHit->normal).norm();
+
+  return HitInfo(ray.at(localHit->t), normal, ray, localHit->t,
+                 localHit->material);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+
+#include "math/transform.hpp"
+#include "shape.hpp"
+
+// Places shared geometry (any bounded shape or mesh) in the scene
+// with an affine transform, without copying the underlying primitives
+class TransformedInstance final : public BoundedShape {
+ public:
+  const std::shared_ptr<const BoundedShape> shape;
+  const Transform toWorld;   // Object space -> world space
+  const Transform toObject;  // World space -> object space
+
+  TransformedInstance(std::shared_ptr<const BoundedShape> shp,
+                      const Transform& transform);
+  std::optional<HitInfo> intersects(const Ray& ray) const override;
+};
@@ -0,0 +1,35 @@
+#include "mesh.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+// Union of bounds of all shapes in the mesh
+static Bounds meshBounds(const PrimitiveSet& shapes) {
+  if (shapes.empty()) {
+    throw std::invalid_argument("Mesh must contain at least one shape");
+  }
+  Bounds b = shapes.bounds(0);
+  for (size_t i = 1; i < shapes.size(); ++i) {
+    b.expand(shapes.bounds(i));
+  }
+  return b;
+}
+
+// Copy shapes and build BVH over them
+Mesh::Mesh(const PrimitiveSet& shps)
+    : BoundedShape(Material{}, meshBounds(shps)), shapes(shps), bvh(shapes) {}
+
+// Find closest intersection among all shapes in the mesh
+std::optional<HitInfo> Mesh::intersects(const Ray& ray) const {
+  std::optional<HitInfo> closestHit;
+  double closestT = std::numeric_limits<double>::max();
+
+  bvh.traverse(shapes, ray, [&](const HitInfo& hitInfo) {
+    if (hitInfo.t < closestT) {
+      closestT = hitInfo.t;
+      closestHit.emplace(hitInfo);
+    }
+  });
+
+  return closestHit;
+}
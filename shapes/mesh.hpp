@@ -0,0 +1,22 @@
+#pragma once
+
+#include <optional>
+
+#include "scene/bvh.hpp"
+#include "scene/primitives.hpp"
+#include "shape.hpp"
+
+// Represents a group of bounded shapes with its own BVH
+// Useful as shared geometry for transformed instances
+class Mesh final : public BoundedShape {
+ private:
+  const PrimitiveSet shapes;
+  const BVH bvh;
+
+ public:
+  Mesh(const PrimitiveSet& shps);
+
+  size_t size() const { return shapes.size(); }
+
+  std::optional<HitInfo> intersects(const Ray& ray) const override;
+};
@@ -1,5 +1,7 @@
 #include "plane.hpp"
 
+#include <algorithm>
+#include <limits>
 #include <optional>
 
 #include "math/vector.hpp"
@@ -26,4 +28,56 @@ std::optional<HitInfo> Plane::intersects(const Ray& ray) const {
 
   Vector hitPoint = ray.at(t);
   return HitInfo(hitPoint, normal, ray, t, &material);
-}
\ No newline at end of file
+}
+
+// Append a plane (normal is normalized)
+void PlaneSet::add(const Vector& point, const Vector& normal,
+                   const Material& mat) {
+  const Vector n = normal.norm();
+  nx.push_back(n.x());
+  ny.push_back(n.y());
+  nz.push_back(n.z());
+  offset.push_back(n.dot(point));
+  materials.push_back(mat);
+}
+
+// Calculate closest intersection of ray with all planes
+// Distances are computed a chunk at a time in a branch-free loop,
+// then scanned for the closest valid hit
+std::optional<HitInfo> PlaneSet::intersects(const Ray& ray) const {
+  const double ox = ray.orig.x(), oy = ray.orig.y(), oz = ray.orig.z();
+  const double dx = ray.dir.x(), dy = ray.dir.y(), dz = ray.dir.z();
+  const int n = static_cast<int>(size());
+
+  double closestT = std::numeric_limits<double>::max();
+  int closestIndex = -1;
+  double ts[CHUNK_SIZE];
+
+  for (int start = 0; start < n; start += CHUNK_SIZE) {
+    const int count = std::min(CHUNK_SIZE, n - start);
+
+    for (int i = 0; i < count; ++i) {
+      const int p = start + i;
+      const double denom = nx[p] * dx + ny[p] * dy + nz[p] * dz;
+      const bool parallel = std::abs(denom) < Vector::EPS;
+      const double t = (offset[p] - (nx[p] * ox + ny[p] * oy + nz[p] * oz)) /
+                       (parallel ? 1.0 : denom);
+      // Parallel planes and hits behind the origin are rejected
+      ts[i] = (parallel || t < Vector::EPS) ? std::numeric_limits<double>::max()
+                                            : t;
+    }
+
+    for (int i = 0; i < count; ++i) {
+      if (ts[i] < closestT) {
+        closestT = ts[i];
+        closestIndex = start + i;
+      }
+    }
+  }
+
+  if (closestIndex < 0) return std::nullopt;
+
+  const Vector normal(nx[closestIndex], ny[closestIndex], nz[closestIndex]);
+  return HitInfo(ray.at(closestT), normal, ray, closestT,
+                 &materials[closestIndex]);
+}
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
 #include "math/vector.hpp"
 #include "shape.hpp"
 
 // Represents an infinite plane
-class Plane : public Shape {
+class Plane final : public Shape {
  public:
   const Vector point;
   const Vector normal;
@@ -14,6 +15,27 @@ class Plane : public Shape {
   Plane(const Vector& pt, const Vector& norm, const Material& mat);
 
   std::optional<HitInfo> intersects(const Ray& ray) const override;
+};
 
-  Plane* clone() const override { return new Plane(*this); }
-};
\ No newline at end of file
+// Stores all infinite planes of a scene in structure-of-arrays layout
+// so a ray can be tested against every plane in one vectorizable loop
+class PlaneSet {
+ private:
+  static constexpr int CHUNK_SIZE = 16;
+
+  std::vector<double> nx, ny, nz;  // Unit normals
+  std::vector<double> offset;      // Plane equation: n * x = offset
+  std::vector<Material> materials;
+
+ public:
+  PlaneSet() = default;
+
+  void add(const Vector& point, const Vector& normal, const Material& mat);
+  size_t size() const { return offset.size(); }
+  bool empty() const { return offset.empty(); }
+
+  // Returns HitInfo of the closest plane hit, std::nullopt otherwise
+  std::optional<HitInfo> intersects(const Ray& ray) const;
+
+  ~PlaneSet() = default;
+};
@@ -0,0 +1,40 @@
+#include "quad.hpp"
+
+// Bounding box of all four corners (padded so flat quads have thickness)
+static Bounds quadBounds(const Vector& c, const Vector& u, const Vector& v) {
+  Bounds b(c);
+  b.expand(c + u);
+  b.expand(c + v);
+  b.expand(c + u + v);
+  return Bounds(b.min - Vector(Vector::EPS), b.max + Vector(Vector::EPS));
+}
+
+Quad::Quad(const Vector& c, const Vector& edgeU, const Vector& edgeV,
+           const Material& mat)
+    : BoundedShape(mat, quadBounds(c, edgeU, edgeV)),
+      w(edgeU.cross(edgeV) / edgeU.cross(edgeV).magSq()),
+      corner(c),
+      u(edgeU),
+      v(edgeV),
+      normal(edgeU.cross(edgeV).norm()) {}
+
+// Intersect supporting plane, then check planar coordinates are in [0, 1]
+std::optional<HitInfo> Quad::intersects(const Ray& ray) const {
+  double denom = normal.dot(ray.dir);
+
+  // Ray is essentially parallel to the quad, no intersection
+  if (std::abs(denom) < Vector::EPS) return std::nullopt;
+
+  double t = (corner - ray.orig).dot(normal) / denom;
+  if (t < Vector::EPS) return std::nullopt;
+
+  const Vector pos = ray.at(t);
+  const Vector q = pos - corner;
+  const double alpha = w.dot(q.cross(v));
+  const double beta = w.dot(u.cross(q));
+
+  if (alpha < 0.0 || alpha > 1.0 || beta < 0.0 || beta > 1.0)
+    return std::nullopt;
+
+  return HitInfo(pos, normal, ray, t, &material);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <optional>
+
+#include "math/vector.hpp"
+#include "shape.hpp"
+
+// Represents a parallelogram spanned by two edges from a corner
+class Quad final : public BoundedShape {
+ private:
+  Vector w;  // Cached u x v / |u x v|^2 for computing planar coordinates
+
+ public:
+  const Vector corner;
+  const Vector u;
+  const Vector v;
+  const Vector normal;
+
+  Quad(const Vector& c, const Vector& edgeU, const Vector& edgeV,
+       const Material& mat);
+  std::optional<HitInfo> intersects(const Ray& ray) const override;
+};
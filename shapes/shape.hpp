@@ -38,8 +38,9 @@ class Shape {
   Shape(const Material& mat) : material(mat) {}
 
   // Returns HitInfo if intersection, std::nullopt otherwise
+  // Scenes dispatch on concrete types (see PrimitiveSet), so this is only
+  // called virtually for standalone or instanced shapes
   virtual std::optional<HitInfo> intersects(const Ray& ray) const = 0;
-  virtual Shape* clone() const = 0;
 
   virtual ~Shape() = default;
 
@@ -82,6 +83,7 @@ class BoundedShape : public Shape {
 
   BoundedShape(const Material& mat, const Vector& bmin, const Vector& bmax)
       : Shape(mat), bounds(bmin, bmax) {}
+  BoundedShape(const Material& mat, const Bounds& b) : Shape(mat), bounds(b) {}
 
   virtual ~BoundedShape() = default;
 };
\ No newline at end of file
@@ -10,13 +10,15 @@
 Sphere::Sphere(const Vector& cen, double r, const Material& mat)
     : BoundedShape(mat, cen - Vector(r, r, r), cen + Vector(r, r, r)),
       center(cen),
-      radius(r) {}
+      radius(r),
+      radiusSq(r * r) {}
 
 // Calculate intersection of ray with sphere
 std::optional<HitInfo> Sphere::intersects(const Ray& ray) const {
+  const Vector oc = ray.orig - center;
   double a = ray.dir * ray.dir;
-  double b = 2.0 * (ray.dir * (ray.orig - center));
-  double c = (ray.orig - center) * (ray.orig - center) - radius * radius;
+  double b = 2.0 * (ray.dir * oc);
+  double c = oc * oc - radiusSq;
 
   double discriminant = b * b - 4 * a * c;
 
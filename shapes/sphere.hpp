@@ -6,12 +6,12 @@
 #include "shape.hpp"
 
 // Represents a sphere in 3D space
-class Sphere : public BoundedShape {
+class Sphere final : public BoundedShape {
  public:
   const Vector center;
   const double radius;
+  const double radiusSq;  // Precomputed for intersection tests
 
   Sphere(const Vector& cen, double r, const Material& mat);
   std::optional<HitInfo> intersects(const Ray& ray) const override;
-  Sphere* clone() const override { return new Sphere(*this); }
 };
\ No newline at end of file
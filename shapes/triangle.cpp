@@ -7,13 +7,13 @@ Triangle::Triangle(const Vector& a, const Vector& b, const Vector& c,
       v0(a),
       v1(b),
       v2(c),
-      normal((b - a).cross(c - a).norm()) {}
+      edge1(b - a),
+      edge2(c - a),
+      normal(edge1.cross(edge2).norm()) {}
 
 // Calculate intersection of ray with triangle using Möller–Trumbore algorithm
 // Using implementation from wikipedia
 std::optional<HitInfo> Triangle::intersects(const Ray& ray) const {
-  Vector edge1 = v1 - v0;
-  Vector edge2 = v2 - v0;
   Vector rayCrossEdge2 = ray.dir.cross(edge2);
   double det = edge1 * rayCrossEdge2;
 
@@ -40,4 +40,66 @@ std::optional<HitInfo> Triangle::intersects(const Ray& ray) const {
 
   // Calculate intersection details
   return HitInfo{ray.at(t), normal, ray, t, &material};
-}
\ No newline at end of file
+}
+
+HitInfo Triangle::hitAt(const Ray& ray, double t) const {
+  return HitInfo{ray.at(t), normal, ray, t, &material};
+}
+
+FloatTriangle::FloatTriangle(const Triangle& tri) {
+  for (int i = 0; i < 3; ++i) {
+    v0[i] = static_cast<float>(tri.v0[i]);
+    v1[i] = static_cast<float>(tri.v1[i]);
+    v2[i] = static_cast<float>(tri.v2[i]);
+  }
+}
+
+// Watertight ray-triangle intersection (Woop, Benthin and Wald 2013)
+// Shears vertices into ray space so edge tests are exact about shared edges
+// and no ray slips between neighbouring triangles
+float FloatTriangle::intersects(const FloatRay& ray) const {
+  const int kx = ray.kx, ky = ray.ky, kz = ray.kz;
+
+  // Vertices relative to ray origin
+  const float ax = v0[kx] - ray.orig[kx], ay = v0[ky] - ray.orig[ky],
+              az = v0[kz] - ray.orig[kz];
+  const float bx = v1[kx] - ray.orig[kx], by = v1[ky] - ray.orig[ky],
+              bz = v1[kz] - ray.orig[kz];
+  const float cx = v2[kx] - ray.orig[kx], cy = v2[ky] - ray.orig[ky],
+              cz = v2[kz] - ray.orig[kz];
+
+  // Shear so the ray points along +z
+  const float axs = ax - ray.sx * az, ays = ay - ray.sy * az;
+  const float bxs = bx - ray.sx * bz, bys = by - ray.sy * bz;
+  const float cxs = cx - ray.sx * cz, cys = cy - ray.sy * cz;
+
+  // Scaled barycentrics (edge functions)
+  float u = cxs * bys - cys * bxs;
+  float v = axs * cys - ays * cxs;
+  float w = bxs * ays - bys * axs;
+
+  // Edge functions that round to zero are recomputed in double
+  if (u == 0.0f || v == 0.0f || w == 0.0f) {
+    u = static_cast<float>(static_cast<double>(cxs) * bys -
+                           static_cast<double>(cys) * bxs);
+    v = static_cast<float>(static_cast<double>(axs) * cys -
+                           static_cast<double>(ays) * cxs);
+    w = static_cast<float>(static_cast<double>(bxs) * ays -
+                           static_cast<double>(bys) * axs);
+  }
+
+  if ((u < 0.0f || v < 0.0f || w < 0.0f) && (u > 0.0f || v > 0.0f || w > 0.0f))
+    return -1.0f;  // Ray passes outside an edge
+
+  const float det = u + v + w;
+  if (det == 0.0f) return -1.0f;  // Ray is parallel to triangle plane
+
+  // Scaled hit distance, must have the same sign as det to be in front
+  const float tScaled =
+      u * (ray.sz * az) + v * (ray.sz * bz) + w * (ray.sz * cz);
+  if ((det < 0.0f) != (tScaled < 0.0f)) return -1.0f;
+
+  const float t = tScaled / det;
+  if (t < ray.tMin) return -1.0f;  // Behind or too close to ray origin
+  return t;
+}
@@ -6,15 +6,30 @@
 #include "shape.hpp"
 
 // Represents a triangle in 3D space
-class Triangle : public BoundedShape {
+class Triangle final : public BoundedShape {
  public:
   const Vector v0;
   const Vector v1;
   const Vector v2;
+  const Vector edge1;  // v1 - v0, precomputed for intersection tests
+  const Vector edge2;  // v2 - v0, precomputed for intersection tests
   const Vector normal;
 
   Triangle(const Vector& a, const Vector& b, const Vector& c,
            const Material& mat);
   std::optional<HitInfo> intersects(const Ray& ray) const override;
-  Triangle* clone() const override { return new Triangle(*this); }
+  // HitInfo for a hit at distance t found by another test
+  HitInfo hitAt(const Ray& ray, double t) const;
+};
+
+// Single-precision triangle vertices for the float intersection path
+struct FloatTriangle {
+  float v0[3];
+  float v1[3];
+  float v2[3];
+
+  FloatTriangle(const Triangle& tri);
+
+  // Watertight ray-triangle test: returns hit distance, or -1 on a miss
+  float intersects(const FloatRay& ray) const;
 };
\ No newline at end of file
@@ -1,18 +1,66 @@
 #include <Foundation/Foundation.hpp>
 #include <Metal/Metal.hpp>
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <optional>
+#include <sstream>
+#include <tuple>
+#include <thread>
 
 #include "math/camera.hpp"
 #include "math/color.hpp"
 #include "math/ray.hpp"
+#include "math/raygen.hpp"
+#include "math/transform.hpp"
 #include "math/vector.hpp"
+#include "renderer/framebuffer.hpp"
+#include "renderer/job.hpp"
+#include "renderer/pool.hpp"
+#include "renderer/refiner.hpp"
+#include "renderer/reprojection.hpp"
+#include "renderer/resolution.hpp"
+#include "renderer/resolve.hpp"
+#include "renderer/rng.hpp"
+#include "renderer/sampler.hpp"
+#include "renderer/telemetry.hpp"
+#include "renderer/tiles.hpp"
+#include "renderer/tracer.hpp"
+#include "scene/bvh.hpp"
+#include "scene/primitives.hpp"
 #include "shaders/metal.hpp"
+#include "shapes/box.hpp"
+#include "shapes/disk.hpp"
+#include "shapes/instance.hpp"
+#include "shapes/mesh.hpp"
 #include "shapes/plane.hpp"
+#include "shapes/quad.hpp"
 #include "shapes/sphere.hpp"
+#include "shapes/triangle.hpp"
+
+// One sphere in front of the camera, small enough to render many passes
+Scene sphereScene() {
+  Scene scene(32, 24, 1);
+  scene.setCamera(Vector(0, 0, -5), Vector(0, 0, 1), 60);
+  scene.addLight(Vector(0, 5, -5), Color(1, 1, 1));
+  scene.addSphere(Vector(0, 0, 0), 1, Material{});
+  return scene;
+}
+
+// A white sphere lit from the camera's side against a black background
+Scene litSphereScene(int w, int h, int maxRefl, double radius = 1) {
+  Scene scene(w, h, maxRefl);
+  scene.setBackground(0, 0, 0);
+  scene.setCamera(Vector(0, -4, 0), Vector(0, 1, 0), 60);
+  scene.addLight(Vector(0, -4, 4), Color(255, 255, 255));
+  scene.addSphere(Vector(0, 0, 0), radius,
+                  Material{.color = Color(255, 255, 255), .reflectivity = 0.0});
+  return scene;
+}
 
 void testColor() {
   std::cout << "Testing Color class..." << std::endl;
@@ -108,6 +156,747 @@ void testPlaneIntersect() {
 
   std::optional<HitInfo> hitInfoOpt2 = plane2.intersects(ray);
   assert(!hitInfoOpt2.has_value());
+
+  // Plane set returns the closest of several planes
+  PlaneSet planes;
+  planes.add(Vector(0.0, 5.0, 0.0), Vector(0.0, 1.0, 0.0), mat);
+  planes.add(Vector(0.0, 0.0, 0.0), Vector(1.0, 0.0, 0.0), mat);
+  planes.add(Vector(0.0, 2.0, 0.0), Vector(0.0, -2.0, 0.0), mat);
+  std::optional<HitInfo> hitInfoOpt3 = planes.intersects(ray);
+  assert(hitInfoOpt3.has_value());
+  assert(std::abs(hitInfoOpt3->t - 3.0) < 1e-6);
+  assert(hitInfoOpt3->pos == Vector(0.0, 2.0, 0.0));
+  assert(hitInfoOpt3->normal == Vector(0.0, -1.0, 0.0));
+}
+
+void testQuadDiskIntersect() {
+  std::cout << "Testing Quad and Disk intersection..." << std::endl;
+
+  Material mat{};
+  Quad quad(Vector(-1.0, -1.0, 0.0), Vector(2.0, 0.0, 0.0),
+            Vector(0.0, 2.0, 0.0), mat);
+  Disk disk(Vector(0.0, 0.0, 0.0), Vector(0.0, 0.0, 3.0), 1.0, mat);
+  Ray ray(Vector(0.0, 0.0, 5.0), Vector(0.0, 0.0, -1.0));
+  Ray cornerRay(Vector(0.9, 0.9, 5.0), Vector(0.0, 0.0, -1.0));
+  Ray outsideRay(Vector(1.1, 0.0, 5.0), Vector(0.0, 0.0, -1.0));
+
+  std::optional<HitInfo> hitInfoOpt1 = quad.intersects(ray);
+  assert(hitInfoOpt1.has_value());
+  assert(std::abs(hitInfoOpt1->t - 5.0) < 1e-6);
+  assert(hitInfoOpt1->normal == Vector(0.0, 0.0, 1.0));
+  assert(quad.intersects(cornerRay).has_value());
+  assert(!quad.intersects(outsideRay).has_value());
+
+  std::optional<HitInfo> hitInfoOpt2 = disk.intersects(ray);
+  assert(hitInfoOpt2.has_value());
+  assert(hitInfoOpt2->pos == Vector(0.0, 0.0, 0.0));
+  assert(!disk.intersects(cornerRay).has_value());
+  assert(!disk.intersects(outsideRay).has_value());
+  assert(disk.bounds.max.x() > 1.0 - 1e-6 && disk.bounds.max.z() < 1e-6);
+}
+
+void testFloatTriangleIntersect() {
+  std::cout << "Testing float Triangle intersection..." << std::endl;
+
+  Material mat{};
+  Triangle tri1(Vector(-1.0, -1.0, 0.0), Vector(1.0, -1.0, 0.0),
+                Vector(1.0, 1.0, 0.0), mat);
+  Triangle tri2(Vector(-1.0, -1.0, 0.0), Vector(1.0, 1.0, 0.0),
+                Vector(-1.0, 1.0, 0.0), mat);
+  Ray ray(Vector(0.2, -0.5, 3.0), Vector(0.0, 0.0, -1.0));
+
+  // Same hit distance as the double test
+  float t = FloatTriangle(tri1).intersects(FloatRay(ray));
+  std::optional<HitInfo> hitInfoOpt = tri1.intersects(ray);
+  assert(hitInfoOpt.has_value() && std::abs(hitInfoOpt->t - t) < 1e-6);
+  assert(FloatTriangle(tri2).intersects(FloatRay(ray)) < 0.0f);
+
+  // Ray through the shared diagonal hits at least one triangle
+  Ray edgeRay(Vector(0.3, 0.3, 3.0), Vector(0.0, 0.0, -1.0));
+  assert(FloatTriangle(tri1).intersects(FloatRay(edgeRay)) >= 0.0f ||
+         FloatTriangle(tri2).intersects(FloatRay(edgeRay)) >= 0.0f);
+}
+
+void testInstanceIntersect() {
+  std::cout << "Testing TransformedInstance intersection..." << std::endl;
+
+  Material mat{};
+  const Transform rot = Transform::rotate(Vector(1.0, 2.0, 3.0), 37.0);
+  const Vector p(0.3, -1.2, 4.0);
+  assert(rot.inverse().applyPoint(rot.applyPoint(p)) == p);
+  assert((rot * rot.inverse()).applyPoint(p) == p);
+
+  // Unit sphere scaled by 2 and moved up by 3
+  std::shared_ptr<const BoundedShape> sphere =
+      std::make_shared<Sphere>(Vector(0.0, 0.0, 0.0), 1.0, mat);
+  TransformedInstance inst1(sphere,
+                            Transform::translate(Vector(0.0, 0.0, 3.0)) *
+                                Transform::scale(Vector(2.0, 2.0, 2.0)));
+  assert(inst1.bounds.min == Vector(-2.0, -2.0, 1.0));
+  assert(inst1.bounds.max == Vector(2.0, 2.0, 5.0));
+
+  Ray ray(Vector(0.0, 0.0, -5.0), Vector(0.0, 0.0, 1.0));
+  std::optional<HitInfo> hitInfoOpt1 = inst1.intersects(ray);
+  assert(hitInfoOpt1.has_value());
+  HitInfo hitInfo = hitInfoOpt1.value();
+  assert(std::abs(hitInfo.t - 6.0) < 1e-6);
+  assert(hitInfo.pos == Vector(0.0, 0.0, 1.0));
+  assert(hitInfo.normal == Vector(0.0, 0.0, -1.0));
+
+  // Flat box rotated 90 degrees about x stands up along z
+  std::shared_ptr<const BoundedShape> box = std::make_shared<Box>(
+      Vector(-1.0, -1.0, -0.1), Vector(1.0, 1.0, 0.1), mat);
+  TransformedInstance inst2(box,
+                            Transform::rotate(Vector(1.0, 0.0, 0.0), 90.0));
+  std::optional<HitInfo> hitInfoOpt2 = inst2.intersects(ray);
+  assert(hitInfoOpt2.has_value());
+  assert(std::abs(hitInfoOpt2->t - 4.0) < 1e-6);
+  assert(hitInfoOpt2->normal == Vector(0.0, 0.0, -1.0));
+
+  Ray missRay(Vector(0.0, 0.5, -5.0), Vector(0.0, 0.0, 1.0));
+  assert(!inst2.intersects(missRay).has_value());
+
+  // Cluster of two spheres shifted along x returns the closest hit
+  PrimitiveSet cluster;
+  cluster.add(Sphere(Vector(-1.0, 0.0, 0.0), 0.5, mat));
+  cluster.add(Sphere(Vector(-1.0, 0.0, 2.0), 0.5, mat));
+  std::shared_ptr<const BoundedShape> mesh = std::make_shared<Mesh>(cluster);
+  TransformedInstance inst3(mesh, Transform::translate(Vector(1.0, 0.0, 0.0)));
+  std::optional<HitInfo> hitInfoOpt3 = inst3.intersects(ray);
+  assert(hitInfoOpt3.has_value());
+  assert(std::abs(hitInfoOpt3->t - 4.5) < 1e-6);
+}
+
+void testRayGenerator() {
+  std::cout << "Testing ray generator..." << std::endl;
+
+  Camera camera;
+  camera.position = Vector(1.0, -2.0, 0.5);
+  camera.setDir(Vector(0.3, 1.0, -0.2));
+  camera.fov = 50.0;
+  const RayGenerator rays(camera, 64, 48);
+
+  // Same rays as Camera::ray
+  auto close = [](const Vector& a, const Vector& b) {
+    return (a - b).mag() < 1e-12;
+  };
+  for (const auto& [i, j] : {std::pair{0.0, 0.0}, std::pair{63.5, 47.5},
+                             std::pair{31.25, 7.75}, std::pair{64.0, 0.0}}) {
+    const Ray expected = camera.ray(i, j, 64, 48);
+    const Ray ray = rays.ray(i, j);
+    assert(close(ray.orig, expected.orig));
+    assert(close(ray.dir, expected.dir));
+  }
+
+  // Batches match single rays
+  RayBatch batch;
+  batch.resize(5 * 3);
+  for (size_t k = 0; k < batch.size(); ++k) {
+    batch.offsetX[k] = 0.1 * k / batch.size();
+    batch.offsetY[k] = 0.5;
+  }
+  rays.tile(10, 20, 15, 23, batch);
+  for (int y = 20, k = 0; y < 23; ++y) {
+    for (int x = 10; x < 15; ++x, ++k) {
+      const Ray expected = rays.ray(x + batch.offsetX[k], y + 0.5);
+      assert(close(batch.ray(k).orig, expected.orig));
+      assert(close(batch.ray(k).dir, expected.dir));
+    }
+  }
+}
+
+void testThreadPool() {
+  std::cout << "Testing ThreadPool..." << std::endl;
+
+  ThreadPool pool{4};
+  std::atomic<int> count{0};
+
+  // Tasks from outside the pool and tasks spawned by workers
+  for (int i = 0; i < 1000; ++i) {
+    pool.enqueue([&pool, &count, i] {
+      count++;
+      if (i % 10 == 0) pool.enqueue([&count] { count++; });
+    });
+  }
+  pool.wait();
+  assert(count == 1100);
+  assert(pool.numTasks() == 0);
+
+  // Reduce from outside the pool, with chunks that don't divide the range
+  const auto sumRange = [](int b, int e) {
+    long long s = 0;
+    for (int i = b; i < e; ++i) s += i;
+    return s;
+  };
+  const auto add = [](long long a, long long b) { return a + b; };
+  assert(pool.parallelReduce(0, 100001, 7, 0LL, sumRange, add) ==
+         5000050000LL);
+  assert(pool.parallelReduce(5, 5, 7, -1LL, sumRange, add) == -1);
+
+  // Nested and concurrent loops each wait only for their own range
+  std::vector<int> hits(64 * 64, 0);
+  std::vector<std::thread> callers;
+  for (int c = 0; c < 2; ++c) {
+    callers.emplace_back([&pool, &hits, c] {
+      pool.parallelFor(c * 32, (c + 1) * 32, 1, [&](int b, int e) {
+        for (int y = b; y < e; ++y) {
+          pool.parallelFor(0, 64, 4, [&](int xb, int xe) {
+            for (int x = xb; x < xe; ++x) hits[y * 64 + x]++;
+          });
+        }
+      });
+    });
+  }
+  for (std::thread& caller : callers) caller.join();
+  for (const int h : hits) assert(h == 1);
+
+  // Higher lanes run first, but a long interactive burst can't starve the
+  // lower lanes
+  ThreadPool single{1};
+  std::atomic<bool> release{false};
+  single.enqueue([&release] {
+    while (!release) std::this_thread::yield();
+  });
+  std::vector<int> order;  // Only touched by the single worker
+  single.enqueue([&order] { order.push_back(2); }, Priority::Background);
+  single.enqueue([&order] { order.push_back(1); }, Priority::Refinement);
+  single.enqueue([&order] { order.push_back(0); }, Priority::Interactive);
+  release = true;
+  single.wait();
+  assert((order == std::vector<int>{0, 1, 2}));
+
+  release = false;
+  single.enqueue([&release] {
+    while (!release) std::this_thread::yield();
+  });
+  order.clear();
+  single.enqueue([&order] { order.push_back(2); }, Priority::Background);
+  for (int i = 0; i < 1000; ++i) {
+    single.enqueue([&order] { order.push_back(0); }, Priority::Interactive);
+  }
+  release = true;
+  single.wait();
+  const auto background = std::find(order.begin(), order.end(), 2);
+  assert(background != order.end() && background - order.begin() < 100);
+
+  // Batches run completely whether idle workers spin or park at once
+  for (const int spinMicros : {0, 200}) {
+    pool.setSpinTime(std::chrono::microseconds(spinMicros));
+    std::atomic<int> batchCount{0};
+    std::vector<std::function<void()>> batch(
+        500, [&batchCount] { batchCount++; });
+    for (int round = 0; round < 20; ++round) {
+      pool.enqueueAll(batch.begin(), batch.end());
+      std::this_thread::sleep_for(std::chrono::microseconds(round * 20));
+    }
+    pool.wait();
+    assert(batchCount == 500 * 20);
+  }
+}
+
+void testPoolStats() {
+  std::cout << "Testing pool stats..." << std::endl;
+
+  ThreadPool pool{2};
+  std::ostringstream csv;
+  {
+    StatsDumper dumper(pool, csv, std::chrono::milliseconds(5), true);
+    std::atomic<int> counter{0};
+    for (int i = 0; i < 200; ++i) {
+      pool.enqueue([&counter] { counter++; });
+    }
+    pool.wait();
+    assert(counter == 200);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+
+  const PoolStats stats = pool.stats();
+  assert(stats.workers.size() == 2);
+  assert(stats.total().tasks == 200);
+  assert(stats.total().injected <= 200);
+  assert(stats.queued == 0);
+  const std::string rows = csv.str();
+  assert(rows.starts_with("elapsed_ms,worker,"));
+  assert(std::count(rows.begin(), rows.end(), '\n') >= 3);  // Header + dump
+
+  std::ostringstream text;
+  printStats(text, stats);
+  assert(text.str().find("worker  1") != std::string::npos);
+}
+
+void testParallelBVHBuild() {
+  std::cout << "Testing parallel BVH build..." << std::endl;
+
+  // Enough spheres that the top levels are split on the pool
+  Material mat{};
+  PrimitiveSet shapes;
+  for (int i = 0; i < 20000; ++i) {
+    const double x = (i * 7919 % 1000) * 0.01;
+    const double y = (i * 104729 % 1000) * 0.01;
+    shapes.add(
+        Sphere(Vector(x, y, (i % 13) * 0.1), 0.02 + (i % 5) * 0.01, mat));
+  }
+
+  ThreadPool pool{4};
+  const BVH serial(shapes);
+  const BVH parallel(shapes, &pool);
+
+  // Same tree, node for node
+  assert(serial.getShapeIndices() == parallel.getShapeIndices());
+  assert(serial.getNodes().size() == parallel.getNodes().size());
+  for (size_t i = 0; i < serial.getNodes().size(); ++i) {
+    const BVHNode& a = serial.getNodes()[i];
+    const BVHNode& b = parallel.getNodes()[i];
+    assert(a.left == b.left && a.right == b.right);
+    assert(a.shapeIndex == b.shapeIndex && a.shapeCount == b.shapeCount);
+    assert(a.bounds.min == b.bounds.min && a.bounds.max == b.bounds.max);
+  }
+}
+
+void testTiles() {
+  std::cout << "Testing tile orders..." << std::endl;
+
+  for (const TileOrder order :
+       {TileOrder::Hilbert, TileOrder::Spiral, TileOrder::Scanline}) {
+    // Every pixel is covered exactly once, edge tiles are clipped
+    const std::vector<Tile> tiles = makeTiles(100, 70, 16, order);
+    assert(tiles.size() == 7 * 5);
+    std::vector<int> covered(100 * 70, 0);
+    for (const Tile& tile : tiles) {
+      assert(tile.width() > 0 && tile.height() > 0);
+      assert(tile.width() <= 16 && tile.height() <= 16);
+      for (int y = tile.y0; y < tile.y1; ++y) {
+        for (int x = tile.x0; x < tile.x1; ++x) covered[y * 100 + x]++;
+      }
+    }
+    assert(std::all_of(covered.begin(), covered.end(),
+                       [](int c) { return c == 1; }));
+  }
+
+  // Consecutive Hilbert tiles share an edge
+  const std::vector<Tile> hilbert = makeTiles(128, 128, 16, TileOrder::Hilbert);
+  for (size_t i = 1; i < hilbert.size(); ++i) {
+    const int dx = std::abs(hilbert[i].x0 - hilbert[i - 1].x0);
+    const int dy = std::abs(hilbert[i].y0 - hilbert[i - 1].y0);
+    assert(dx + dy == 16);
+  }
+
+  // The spiral starts at the center
+  const Tile first = makeTiles(96, 96, 32, TileOrder::Spiral)[0];
+  assert(first.x0 == 32 && first.y0 == 32);
+}
+
+void testResolver() {
+  std::cout << "Testing resolver..." << std::endl;
+
+  // Linear output matches Color's own conversion
+  const Resolver linear;
+  std::vector<Color> colors;
+  std::vector<int> samples;
+  for (int i = 0; i < 500; ++i) {
+    samples.push_back(i % 7);
+    colors.push_back(Color(i / 250.0, (i % 37) / 9.0, -0.1 + i / 400.0));
+  }
+  std::vector<uint8_t> rgba(colors.size() * 4);
+  linear.resolveRow(colors.data(), samples.data(), colors.size(),
+                    rgba.data(), 4);
+  for (size_t i = 0; i < colors.size(); ++i) {
+    if (samples[i] == 0) {
+      assert(rgba[i * 4 + 3] == 0);
+      continue;
+    }
+    const auto bytes =
+        (colors[i] / static_cast<double>(samples[i])).clamp().getBytes();
+    for (int c = 0; c < 3; ++c) assert(rgba[i * 4 + c] == bytes[c]);
+    assert(rgba[i * 4 + 3] == 255);
+  }
+
+  // Curves and exposure
+  const Color grey(0.5, 0.0, 1.0);
+  uint8_t rgb[3];
+  Resolver(ToneMapping{.curve = ToneCurve::SRGB})
+      .resolveRow(&grey, nullptr, 1, rgb, 3);
+  assert(rgb[0] == 188 && rgb[1] == 0 && rgb[2] == 255);
+  Resolver(ToneMapping{.curve = ToneCurve::Gamma, .gamma = 2.2})
+      .resolveRow(&grey, nullptr, 1, rgb, 3);
+  assert(rgb[0] == 186);
+  Resolver(ToneMapping{.exposure = 0.5}).resolveRow(&grey, nullptr, 1, rgb, 3);
+  assert(rgb[0] == 64 && rgb[2] == 128);
+}
+
+void testFrameBuffer() {
+  std::cout << "Testing frame buffer..." << std::endl;
+
+  const std::vector<Tile> tiles = makeTiles(16, 8, 8, TileOrder::Scanline);
+  FrameBuffer frames(tiles);
+  const int size = 8 * 8 * 4;
+  assert(!frames.take(0, 1));  // Nothing published
+
+  std::fill(frames.back(0), frames.back(0) + size, 7);
+  frames.publish(0, 1);
+  assert(!frames.take(1, 1));
+  assert(!frames.take(0, 2));  // Stale generation, dropped
+  std::fill(frames.back(0), frames.back(0) + size, 9);
+  frames.publish(0, 2);
+  const uint8_t* tile = frames.take(0, 2);
+  assert(tile && tile[0] == 9 && tile[size - 1] == 9);
+  assert(!frames.take(0, 2));  // Taken once
+
+  // A reader racing a writer only ever sees whole tiles
+  const int publishes = 20000;
+  std::thread writer([&] {
+    for (int k = 1; k <= publishes; ++k) {
+      std::fill(frames.back(1), frames.back(1) + size, k % 251);
+      frames.publish(1, 3);
+    }
+  });
+  int last = -1;
+  int taken = 0;
+  while (last != publishes % 251) {
+    const uint8_t* data = frames.take(1, 3);
+    if (!data) continue;
+    assert(std::all_of(data, data + size,
+                       [&](uint8_t b) { return b == data[0]; }));
+    last = data[0];
+    taken++;
+  }
+  writer.join();
+  assert(taken > 0);
+
+  // Pixels publish finished tiles only once frames are enabled
+  Scene scene = sphereScene();
+  ThreadPool pool{2};
+  Tracer tracer(scene, pool);
+  Pixels offline(32, 24, 8);
+  tracer.renderPass(offline);
+  assert(!offline.frames);
+  Pixels shown(32, 24, 8);
+  shown.enableFrames();
+  tracer.renderPass(shown);
+  assert(shown.frames->take(0, shown.currentGeneration()));
+}
+
+void testAdaptiveSampling() {
+  std::cout << "Testing adaptive sampling..." << std::endl;
+
+  ThreadPool pool{2};
+
+  // Nothing but background: every pixel converges at the minimum samples
+  Scene empty(32, 24, 1);
+  empty.setCamera(Vector(0, 0, -5), Vector(0, 0, 1), 60);
+  empty.addLight(Vector(0, 5, -5), Color(1, 1, 1));
+  empty.addSphere(Vector(0, 0, -100), 1, Material{});  // Behind the camera
+  Tracer flat(empty, pool);
+  flat.setAdaptiveSampling(0.01, 4);
+  Pixels still(32, 24, 8);
+  for (int pass = 0; pass < 3; ++pass) flat.renderPass(still);
+  assert(!still.converged());
+  flat.renderPass(still);
+  assert(still.converged());
+  assert(still.meanError(0) == 0.0);
+  flat.renderPass(still);
+  assert(std::all_of(still.pxSamples.begin(), still.pxSamples.end(),
+                     [](int n) { return n == 4; }));
+
+  // The shaded sphere keeps refining while the background stops
+  Scene scene = litSphereScene(32, 24, 1);
+  Tracer tracer(scene, pool);
+  tracer.setAdaptiveSampling(0.001, 4);
+  Pixels pixels(32, 24, 8);
+  for (int pass = 0; pass < 12; ++pass) tracer.renderPass(pixels);
+  assert(pixels.pxSamples[0] == 4);
+  assert(pixels.pxSamples[12 * 32 + 16] == 12);
+  assert(!pixels.converged());
+
+  // A new generation starts over
+  pixels.invalidate();
+  tracer.renderPass(pixels);
+  assert(pixels.pxSamples[0] == 1);
+}
+
+void testResolutionScaling() {
+  std::cout << "Testing resolution scaling..." << std::endl;
+
+  // Slow frames lower the resolution, fast ones bring it back
+  ResolutionScaler scaler(0.01);
+  assert(scaler.factor() == 2);
+  scaler.update(0.02);  // 0.08 s at full size
+  assert(scaler.factor() == 4);
+  scaler.update(0.005);
+  assert(scaler.factor() == 4);  // Clamped
+  for (int i = 0; i < 10; ++i) scaler.update(0.0001);
+  assert(scaler.factor() == 1);
+
+  // Downscaled pixels cover the same view
+  Scene scene = litSphereScene(30, 22, 1, 2);
+  const RayGenerator rays(scene.getCamera(), 30, 22);
+  const Ray low = rays.downscaled(4).ray(3.25, 2.5);
+  const Ray full = rays.ray(13.0, 10.0);
+  assert((low.dir - full.dir).mag() < 1e-12);
+
+  // Lit sphere in the middle, black corners
+  ThreadPool pool{2};
+  Tracer tracer(scene, pool);
+  Pixels pixels(8, 6, 4);  // 30x22 at a quarter, rounded up
+  tracer.renderPass(pixels, Priority::Interactive, 4);
+  assert(pixels.pxColors[2 * 8 + 3].luminance() > 0.0);
+  assert(pixels.pxColors[0].luminance() == 0.0);
+
+  std::vector<uint8_t> image8(30 * 22 * 3, 7);
+  upsample(pixels, 4, 30, 22, image8, pool);
+  assert(image8[0] == 0);
+  assert(image8[(11 * 30 + 15) * 3] > 0);
+  assert(image8.back() == 0);  // Edge clamps inside the low-res image
+}
+
+void testReprojection() {
+  std::cout << "Testing reprojection..." << std::endl;
+
+  Scene scene(48, 32, 1);
+  scene.setBackground(0, 0, 0);
+  scene.setCamera(Vector(0, -6, 0), Vector(0, 1, 0), 60);
+  scene.addLight(Vector(2, -4, 6), Color(255, 255, 255));
+  scene.addPlane(Vector(0, 0, -1), Vector(0, 0, 1),
+                 Material{.color = Color(200, 120, 80), .reflectivity = 0.0});
+  scene.addSphere(Vector(0, 0, 0), 1,
+                  Material{.color = Color(80, 160, 255), .reflectivity = 0.0});
+
+  // Projecting a ray's direction gives back its pixel
+  const RayGenerator before(scene.getCamera(), 48, 32);
+  const std::optional<ImagePoint> point =
+      before.projectDir(before.ray(10.25, 20.75).dir);
+  assert(point && std::abs(point->i - 10.25) < 1e-9 &&
+         std::abs(point->j - 20.75) < 1e-9);
+  assert(!before.projectDir(Vector(0, -1, 0)));  // Behind the camera
+
+  ThreadPool pool{2};
+  Tracer tracer(scene, pool);
+  Pixels pixels(48, 32, 8);
+  for (int pass = 0; pass < 8; ++pass) tracer.renderPass(pixels);
+  assert(pixels.pxDepth[0] < 0.0f);  // Sky
+  assert(std::abs(pixels.pxDepth[16 * 48 + 24] - 5.0f) < 0.1f);
+
+  // Same view: history comes back at a reduced weight
+  Reprojector reprojector(48, 32);
+  const Color mean = pixels.pxColors[31 * 48 + 5] / 8.0;
+  reprojector.capture(pixels, before, pixels.currentGeneration(), pool);
+  pixels.invalidate();
+  const int same = reprojector.apply(pixels, before, pool);
+  assert(same > 48 * 32 * 3 / 4);
+  assert(pixels.pxSamples[31 * 48 + 5] == 2);
+  assert((pixels.pxColors[31 * 48 + 5] / 2.0 - mean).mag() < 1e-9);
+  assert(pixels.pxSamples[0] == 2 && pixels.pxDepth[0] < 0.0f);  // Sky
+  assert(reprojector.apply(pixels, before, pool) == 0);  // Used once
+
+  // Small pan: seeded pixels match a fresh render of the new view
+  for (int pass = 0; pass < 8; ++pass) tracer.renderPass(pixels);
+  reprojector.capture(pixels, before, pixels.currentGeneration(), pool);
+  scene.moveCameraPosition(Vector(0.15, 0, 0.05));
+  pixels.invalidate();
+  const RayGenerator after(scene.getCamera(), 48, 32);
+  const int panned = reprojector.apply(pixels, after, pool);
+  assert(panned > 48 * 32 / 2);
+
+  Pixels fresh(48, 32, 8);
+  for (int pass = 0; pass < 8; ++pass) tracer.renderPass(fresh);
+  double error = 0.0;
+  for (int i = 0; i < 48 * 32; ++i) {
+    if (pixels.pxSamples[i] == 0) continue;
+    const Color a = pixels.pxColors[i] / pixels.pxSamples[i];
+    const Color b = fresh.pxColors[i] / fresh.pxSamples[i];
+    error += std::abs(a.luminance() - b.luminance());
+  }
+  assert(error / panned < 0.01);
+}
+
+void testSamplers() {
+  std::cout << "Testing samplers..." << std::endl;
+
+  for (const SamplerType type :
+       {SamplerType::Stratified, SamplerType::Sobol, SamplerType::R2,
+        SamplerType::BlueNoise}) {
+    const std::unique_ptr<Sampler> sampler = makeSampler(type, 7);
+    for (uint32_t i = 0; i < 64; ++i) {
+      const SamplePoint p = sampler->get(3, 5, i);
+      assert(p.x >= 0.0 && p.x < 1.0 && p.y >= 0.0 && p.y < 1.0);
+      // Same pixel and index, same sample
+      const SamplePoint q = sampler->get(3, 5, i);
+      assert(p.x == q.x && p.y == q.y);
+    }
+  }
+
+  // Each group of four Sobol samples has one in every quarter of the pixel
+  const SobolSampler sobol;
+  for (int px = 0; px < 8; ++px) {
+    for (uint32_t first = 0; first < 16; first += 4) {
+      int quarters = 0;
+      for (uint32_t i = first; i < first + 4; ++i) {
+        const SamplePoint p = sobol.get(px, 2, i);
+        quarters |= 1 << ((p.x >= 0.5) + 2 * (p.y >= 0.5));
+      }
+      assert(quarters == 0b1111);
+    }
+  }
+
+  // Pixels get different sequences
+  const SamplePoint a = sobol.get(0, 0, 1), b = sobol.get(1, 0, 1);
+  assert(a.x != b.x || a.y != b.y);
+}
+
+void testDeterministicRender() {
+  std::cout << "Testing deterministic rendering..." << std::endl;
+
+  // Known answers for Philox4x32-10 (Random123)
+  assert((philox({0, 0, 0, 0}, {0, 0}) ==
+          std::array<uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c,
+                                  0x9b00dbd8}));
+  assert((philox({~0u, ~0u, ~0u, ~0u}, {~0u, ~0u}) ==
+          std::array<uint32_t, 4>{0x408f276d, 0x41c83b0e, 0xa20bc7c6,
+                                  0x6d5451fd}));
+  const SampleRng rng(3, 4, 5);
+  assert(rng.bits(0) != rng.bits(1));
+  assert(rng.bits(1) == SampleRng(3, 4, 5).bits(1));
+  assert(rng.bits(0) != SampleRng(3, 4, 6).bits(0));
+
+  // Same pixels for any thread count, tile size and tile order
+  Scene scene = litSphereScene(32, 24, 2);
+  scene.addSphere(Vector(1.2, -0.5, 0.5), 0.4,
+                  Material{.color = Color(255, 0, 0), .reflectivity = 0.5});
+
+  std::vector<Color> reference;
+  const std::tuple<int, int, TileOrder> setups[] = {
+      {1, 32, TileOrder::Hilbert},
+      {3, 8, TileOrder::Hilbert},
+      {2, 5, TileOrder::Spiral},
+      {3, 7, TileOrder::Scanline}};
+  for (const auto& [threads, tileSize, order] : setups) {
+    ThreadPool pool(threads);
+    Tracer tracer(scene, pool);
+    tracer.setAdaptiveSampling(0.002);
+    Pixels pixels(32, 24, tileSize, order);
+    for (int pass = 0; pass < 6; ++pass) tracer.renderPass(pixels);
+    if (reference.empty()) reference = pixels.pxColors;
+    assert(pixels.pxColors == reference);
+  }
+}
+
+void testRefiner() {
+  std::cout << "Testing refiner..." << std::endl;
+
+  Scene scene = sphereScene();
+  ThreadPool pool{3};
+  Tracer tracer(scene, pool);
+  Pixels pixels(32, 24, 8);
+  Refiner refiner(tracer, pixels);
+
+  refiner.start();
+  while (refiner.completedPasses() < 3) {
+    std::this_thread::yield();
+  }
+
+  // A new view starts over and stops at once
+  pixels.invalidate();
+  refiner.restart();
+  while (refiner.completedPasses() < 3) {
+    std::this_thread::yield();
+  }
+  refiner.stop();
+  assert(pool.numTasks() == 0);
+
+  // Tiles are handed out in turn: sample counts stay within one pass or so
+  const auto [lo, hi] =
+      std::minmax_element(pixels.pxSamples.begin(), pixels.pxSamples.end());
+  assert(*lo >= 2);
+  assert(*hi - *lo <= 2);
+}
+
+void testFrameBudget() {
+  std::cout << "Testing frame budget..." << std::endl;
+
+  // Percentiles by nearest rank over the window
+  FrameMetrics metrics;
+  for (int ms = 1; ms <= 100; ++ms) {
+    metrics.addFrame(std::chrono::milliseconds(ms), 1000);
+  }
+  FrameStats stats = metrics.stats();
+  assert(stats.frames == 100);
+  assert(std::abs(stats.p50 - 50.0) < 1e-9);
+  assert(std::abs(stats.p99 - 99.0) < 1e-9);
+  assert(std::abs(stats.worst - 100.0) < 1e-9);
+  assert(std::abs(stats.samplesPerSecond - 100000 / 5.05) < 1e-6);
+  for (int i = 0; i < 1000; ++i) {
+    metrics.addFrame(std::chrono::milliseconds(2), 0);
+  }
+  stats = metrics.stats();
+  assert(stats.frames < 1000);  // Old frames age out
+  assert(std::abs(stats.worst - 2.0) < 1e-9);
+
+  Scene scene = sphereScene();
+  ThreadPool pool{2};
+  Tracer tracer(scene, pool);
+  Pixels pixels(32, 24, 8);
+  Refiner refiner(tracer, pixels);
+
+  // No timings yet: a frame probes a single tile
+  refiner.setFrameBudget(std::chrono::nanoseconds(1));
+  refiner.start();
+  refiner.stop();
+  assert(refiner.samplesTraced() == 64);
+
+  // A budget far below one tile still lets one tile through per frame
+  refiner.start();
+  for (int frame = 0; frame < 3; ++frame) refiner.beginFrame();
+  refiner.stop();
+  assert(refiner.samplesTraced() == 64 + 3 * 64);
+
+  // A generous budget refines freely
+  refiner.setFrameBudget(std::chrono::seconds(10));
+  refiner.start();
+  while (refiner.completedPasses() < 2) {
+    refiner.beginFrame();
+    std::this_thread::yield();
+  }
+  refiner.stop();
+}
+
+// Awaits two jobs rendering at once, true if their images match
+Job<bool> renderTwice(Scene& scene, ThreadPool& pool) {
+  Job<std::vector<uint8_t>> a = renderAsync(scene, 1, Priority::Refinement,
+                                            pool);
+  Job<std::vector<uint8_t>> b = renderAsync(scene, 1, Priority::Refinement,
+                                            pool);
+  const std::vector<uint8_t> imageA = co_await a;
+  const std::vector<uint8_t> imageB = co_await b;
+  co_return imageA == imageB;
+}
+
+void testRenderJob() {
+  std::cout << "Testing render jobs..." << std::endl;
+
+  Scene scene = sphereScene();
+  ThreadPool pool{2};
+
+  // Progress is published after every pass
+  Job<std::vector<uint8_t>> job =
+      renderAsync(scene, 4, Priority::Refinement, pool);
+  const std::vector<uint8_t> image = job.get();
+  assert(image.size() == 32 * 24 * 3);
+  assert(job.done());
+  assert(job.progress().passes == 4 && job.progress().totalPasses == 4);
+
+  // Cancelled jobs stop at the next pass and keep what they have
+  Job<std::vector<uint8_t>> endless =
+      renderAsync(scene, 1 << 30, Priority::Background, pool);
+  while (endless.progress().passes == 0) std::this_thread::yield();
+  endless.cancel();
+  assert(endless.get().size() == 32 * 24 * 3);
+  assert(endless.progress().passes < 1 << 30);
+
+  // Jobs awaiting jobs, all on the pool
+  assert(renderTwice(scene, pool).get());
+
+  // Destroying a running job cancels it and waits
+  { Job<std::vector<uint8_t>> abandoned = renderAsync(scene, 1 << 30); }
 }
 
 void testMetal() {
@@ -125,6 +914,24 @@ int main() {
   testVector();
   testSphereIntersect();
   testPlaneIntersect();
+  testQuadDiskIntersect();
+  testFloatTriangleIntersect();
+  testInstanceIntersect();
+  testRayGenerator();
+  testThreadPool();
+  testPoolStats();
+  testParallelBVHBuild();
+  testTiles();
+  testResolver();
+  testFrameBuffer();
+  testAdaptiveSampling();
+  testResolutionScaling();
+  testReprojection();
+  testSamplers();
+  testDeterministicRender();
+  testRefiner();
+  testFrameBudget();
+  testRenderJob();
   testMetal();
 
   std::cout << "All tests passed!" << std::endl;